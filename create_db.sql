@@ -10,7 +10,7 @@ USE kv_store;
 
 CREATE TABLE IF NOT EXISTS key_value_pairs (
     key_name VARCHAR(255) PRIMARY KEY,
-    value_data TEXT NOT NULL,
+    value_data MEDIUMBLOB NOT NULL,
     created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
     updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP
 );
\ No newline at end of file
@@ -0,0 +1,116 @@
+// log_decoder/main.cpp
+// Turns the server's binary access log (ACCESS_LOG_PATH) back into text or CSV.
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+// record layout shared with the server
+#include "../server/access_record.h"
+
+static const char* source_name(uint8_t source) {
+    switch (static_cast<AccessSource>(source)) {
+        case AccessSource::CACHE:    return "cache";
+        case AccessSource::DATABASE: return "database";
+        case AccessSource::NONE:     break;
+    }
+    return "-";
+}
+
+// inline key bytes with non-printables as \xNN, "..." when the key was cut
+static std::string key_text(const AccessRecord& rec, bool csv) {
+    std::string out;
+    size_t n = rec.key_len < ACCESS_KEY_INLINE ? rec.key_len : ACCESS_KEY_INLINE;
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = static_cast<unsigned char>(rec.key[i]);
+        if (c < 0x20 || c >= 0x7f || c == '\\' || (csv && (c == '"' || c == ','))) {
+            char hex[5];
+            std::snprintf(hex, sizeof(hex), "\\x%02x", c);
+            out += hex;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    if (rec.key_len > n) out += "...";
+    return out;
+}
+
+static std::string time_text(uint64_t time_ns) {
+    std::time_t seconds = static_cast<std::time_t>(time_ns / 1000000000ull);
+    std::tm tm_buf;
+    localtime_r(&seconds, &tm_buf);
+    char buf[48];
+    size_t len = std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm_buf);
+    std::snprintf(buf + len, sizeof(buf) - len, ".%06llu", static_cast<unsigned long long>(time_ns % 1000000000ull / 1000));
+    return buf;
+}
+
+static std::string remote_text(const AccessRecord& rec) {
+    char addr[INET_ADDRSTRLEN] = "-";
+    in_addr in;
+    in.s_addr = rec.remote_addr;
+    inet_ntop(AF_INET, &in, addr, sizeof(addr));
+    return std::string(addr) + ":" + std::to_string(rec.remote_port);
+}
+
+// returns the number of records printed, or -1 if the file is not an access log
+static long long decode_file(const char* path, bool csv) {
+    FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        std::fprintf(stderr, "%s: %s\n", path, std::strerror(errno));
+        return -1;
+    }
+    AccessLogHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, ACCESS_LOG_MAGIC, sizeof(header.magic)) != 0
+        || header.version != ACCESS_LOG_VERSION || header.record_size != sizeof(AccessRecord)) {
+        std::fprintf(stderr, "%s: not a version %u access log\n", path, ACCESS_LOG_VERSION);
+        std::fclose(file);
+        return -1;
+    }
+
+    long long printed = 0;
+    AccessRecord batch[1024];
+    size_t count;
+    while ((count = std::fread(batch, sizeof(AccessRecord), 1024, file)) > 0) {
+        for (size_t i = 0; i < count; ++i) {
+            const AccessRecord& rec = batch[i];
+            if (rec.time_ns == 0) continue; // slot not written (yet)
+            ++printed;
+            const char* op = access_op_name(static_cast<AccessOp>(rec.op));
+            if (csv) {
+                std::printf("%llu,%s,%s,\"%s\",%u,%016llx,%u,%s,%u,%s\n", static_cast<unsigned long long>(rec.time_ns),
+                            time_text(rec.time_ns).c_str(), op, key_text(rec, true).c_str(), rec.key_len,
+                            static_cast<unsigned long long>(rec.key_hash), rec.status, source_name(rec.source),
+                            rec.latency_ns, remote_text(rec).c_str());
+            } else {
+                std::printf("[%s] %s %s -> %u %s %.1f us from %s\n", time_text(rec.time_ns).c_str(), op,
+                            key_text(rec, false).c_str(), rec.status, source_name(rec.source), rec.latency_ns / 1000.0,
+                            remote_text(rec).c_str());
+            }
+        }
+    }
+    std::fclose(file);
+    return printed;
+}
+
+int main(int argc, char* argv[]) {
+    bool csv = false;
+    int first = 1;
+    if (argc > 1 && std::strcmp(argv[1], "--csv") == 0) {
+        csv = true;
+        first = 2;
+    }
+    if (first >= argc) {
+        std::fprintf(stderr, "Usage: %s [--csv] <access_log.000000> [more segments...]\n", argv[0]);
+        return 1;
+    }
+
+    if (csv) std::printf("time_ns,time,op,key,key_len,key_hash,status,source,latency_ns,remote\n");
+    int failed = 0;
+    for (int i = first; i < argc; ++i) {
+        if (decode_file(argv[i], csv) < 0) failed = 1;
+    }
+    return failed;
+}
@@ -0,0 +1,166 @@
+#include "access_log.h"
+#include "config.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <unistd.h>
+
+std::atomic<bool> access_log_active{false};
+
+namespace {
+
+struct Segment {
+    uint64_t number;
+    char* base;
+    size_t length;
+    std::atomic<size_t> next{0}; // next free record slot
+};
+
+std::string base_path;
+std::atomic<Segment*> current{nullptr};
+// the segment before current; writers that claimed a slot in it just before
+// the switch may still be copying, so it is only unmapped at the next switch
+Segment* retired = nullptr;
+std::mutex rotate_mutex;
+std::atomic<uint64_t> dropped{0};
+// after a failed switch (disk full, fd limit) writers drop records for a second
+// instead of retrying the open on every request
+std::atomic<int64_t> retry_after_ns{0};
+
+int64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+Segment* open_segment(uint64_t number) {
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), ".%06llu", static_cast<unsigned long long>(number));
+    std::string path = base_path + suffix;
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("ERROR: cannot create access log " + path + ": " + std::string(strerror(errno)));
+        return nullptr;
+    }
+    // sized up front (sparse), so writers never touch a page past the end of the file
+    size_t length = sizeof(AccessLogHeader) + ACCESS_LOG_SEGMENT_RECORDS * sizeof(AccessRecord);
+    void* base = MAP_FAILED;
+    if (::ftruncate(fd, static_cast<off_t>(length)) == 0) {
+        base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int err = errno;
+    ::close(fd); // the mapping keeps the file
+    if (base == MAP_FAILED) {
+        LOG_ERROR("ERROR: cannot map access log " + path + ": " + std::string(strerror(err)));
+        return nullptr;
+    }
+
+    AccessLogHeader header = {};
+    std::memcpy(header.magic, ACCESS_LOG_MAGIC, sizeof(header.magic));
+    header.version = ACCESS_LOG_VERSION;
+    header.record_size = sizeof(AccessRecord);
+    header.segment = number;
+    std::memcpy(base, &header, sizeof(header));
+
+    Segment* seg = new Segment();
+    seg->number = number;
+    seg->base = static_cast<char*>(base);
+    seg->length = length;
+    return seg;
+}
+
+// called by the writer that found seg full
+void rotate(Segment* seg) {
+    std::lock_guard<std::mutex> lock(rotate_mutex);
+    if (current.load(std::memory_order_acquire) != seg) return; // someone else already switched
+    Segment* next = open_segment(seg->number + 1);
+    if (!next) {
+        retry_after_ns.store(monotonic_ns() + 1000000000, std::memory_order_relaxed);
+        return;
+    }
+    current.store(next, std::memory_order_release);
+    if (retired) {
+        ::munmap(retired->base, retired->length);
+        delete retired;
+    }
+    retired = seg;
+    LOG_INFO("Access log switched to segment " + std::to_string(next->number));
+}
+
+// FNV-1a
+uint64_t hash_key(std::string_view key) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+void parse_client(std::string_view client, AccessRecord& rec) {
+    size_t colon = client.rfind(':');
+    if (colon == std::string_view::npos || colon >= INET_ADDRSTRLEN) return;
+    char addr[INET_ADDRSTRLEN];
+    std::memcpy(addr, client.data(), colon);
+    addr[colon] = '\0';
+    in_addr in;
+    if (inet_pton(AF_INET, addr, &in) == 1) rec.remote_addr = in.s_addr;
+    unsigned port = 0;
+    for (size_t i = colon + 1; i < client.size() && client[i] >= '0' && client[i] <= '9'; ++i) {
+        port = port * 10 + static_cast<unsigned>(client[i] - '0');
+    }
+    rec.remote_port = static_cast<uint16_t>(port);
+}
+
+} // namespace
+
+bool access_log_open(const std::string& path) {
+    base_path = path;
+    Segment* seg = open_segment(0);
+    if (!seg) return false;
+    current.store(seg, std::memory_order_release);
+    access_log_active.store(true, std::memory_order_release);
+    LOG_INFO("Binary access log enabled: " + path + ".*");
+    return true;
+}
+
+void access_log_write(AccessOp op, std::string_view key, int status, AccessSource source,
+                      uint64_t latency_ns, std::string_view client) {
+    AccessRecord rec = {};
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    rec.time_ns = static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+    rec.key_hash = hash_key(key);
+    rec.latency_ns = static_cast<uint32_t>(std::min<uint64_t>(latency_ns, UINT32_MAX));
+    parse_client(client, rec);
+    rec.status = static_cast<uint16_t>(status);
+    rec.op = static_cast<uint8_t>(op);
+    rec.source = static_cast<uint8_t>(source);
+    rec.key_len = static_cast<uint8_t>(std::min<size_t>(key.size(), 255));
+    std::memcpy(rec.key, key.data(), std::min<size_t>(key.size(), ACCESS_KEY_INLINE));
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        Segment* seg = current.load(std::memory_order_acquire);
+        size_t slot = seg->next.fetch_add(1, std::memory_order_relaxed);
+        if (slot < ACCESS_LOG_SEGMENT_RECORDS) {
+            std::memcpy(seg->base + sizeof(AccessLogHeader) + slot * sizeof(AccessRecord), &rec, sizeof(rec));
+            return;
+        }
+        if (monotonic_ns() < retry_after_ns.load(std::memory_order_relaxed)) break;
+        rotate(seg);
+    }
+    dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t access_log_dropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,35 @@
+#ifndef SERVER_ACCESS_LOG_H
+#define SERVER_ACCESS_LOG_H
+
+#include "access_record.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Optional binary access log (ACCESS_LOG_PATH in config.h). Every request
+// becomes one fixed-size AccessRecord copied into a memory-mapped file:
+// writers claim a slot with one atomic add and the kernel writes the pages
+// back, so the request path does no formatting and no system calls. Files
+// are <path>.<segment>, ACCESS_LOG_SEGMENT_RECORDS records each, and are
+// turned back into text or CSV by log_decoder/. Pages reach the file even
+// if the process dies, so there is nothing to close.
+
+// maps the first segment; false (and logged) on failure
+bool access_log_open(const std::string& path);
+
+extern std::atomic<bool> access_log_active;
+
+inline bool access_log_enabled() {
+    return access_log_active.load(std::memory_order_relaxed);
+}
+
+// client is "addr:port" as passed to the kv handlers
+void access_log_write(AccessOp op, std::string_view key, int status, AccessSource source,
+                      uint64_t latency_ns, std::string_view client);
+
+// records lost because a new segment could not be created
+uint64_t access_log_dropped();
+
+#endif
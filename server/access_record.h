@@ -0,0 +1,61 @@
+#ifndef SERVER_ACCESS_RECORD_H
+#define SERVER_ACCESS_RECORD_H
+
+#include <cstddef>
+#include <cstdint>
+
+// On-disk layout of the binary access log (see access_log.h), shared with
+// the offline decoder in log_decoder/. Little-endian, fixed size, no
+// pointers; bump ACCESS_LOG_VERSION whenever a field changes.
+
+const char ACCESS_LOG_MAGIC[8] = {'K', 'V', 'A', 'C', 'C', 'L', 'O', 'G'};
+const uint32_t ACCESS_LOG_VERSION = 1;
+
+enum class AccessOp : uint8_t {
+    OTHER = 0,
+    GET, CREATE, UPDATE, DELETE, MGET, MSET, STATS,              // HTTP routes
+    RESP_GET, RESP_SET, RESP_DEL, RESP_MGET, RESP_MSET, RESP_OTHER, // RESP commands
+    METRICS,
+    ADMIN,
+    COUNT
+};
+
+inline const char* access_op_name(AccessOp op) {
+    static const char* const names[] = {"OTHER", "GET", "CREATE", "UPDATE", "DELETE", "MGET", "MSET", "STATS",
+                                        "RESP_GET", "RESP_SET", "RESP_DEL", "RESP_MGET", "RESP_MSET", "RESP_OTHER",
+                                        "METRICS", "ADMIN"};
+    static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(AccessOp::COUNT), "access op without a name");
+    return op < AccessOp::COUNT ? names[static_cast<size_t>(op)] : "?";
+}
+
+enum class AccessSource : uint8_t { NONE = 0, CACHE, DATABASE };
+
+// one per file, followed by records until the end of the file
+struct AccessLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t segment;       // sequence number of this file
+    uint8_t reserved[40];
+};
+
+const uint32_t ACCESS_KEY_INLINE = 32;
+
+struct AccessRecord {
+    uint64_t time_ns;       // wall clock, ns since the epoch; 0 marks an unused slot
+    uint64_t key_hash;      // FNV-1a of the full key
+    uint32_t latency_ns;    // saturates at ~4.29 s
+    uint32_t remote_addr;   // IPv4, network byte order
+    uint16_t remote_port;
+    uint16_t status;        // HTTP status; RESP: 200 reply, 404 nil, 500 error
+    uint8_t op;             // AccessOp
+    uint8_t source;         // AccessSource
+    uint8_t key_len;        // full key length, capped at 255
+    uint8_t reserved;
+    char key[ACCESS_KEY_INLINE]; // first bytes of the key, not terminated
+};
+
+static_assert(sizeof(AccessLogHeader) == 64, "access log header layout changed");
+static_assert(sizeof(AccessRecord) == 64, "access record layout changed");
+
+#endif
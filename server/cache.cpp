@@ -1,18 +1,29 @@
 #include "cache.h"
 #include "config.h"
+#include "metrics.h"
 
-std::list<CacheEntry> lru_list;
-std::map<std::string, std::list<CacheEntry>::iterator> lru_map; 
-std::mutex cache_mutex;
+LruList lru_list;
+LruMap lru_map;
+ProfiledMutex cache_mutex{MetricLock::CACHE};
 
 // LRU - Least recently used cache
 // Mutexes are obtained by caller in server_app.cpp before calling these functions
 
-void cache_put(const std::string& key, const std::string& value) {
+static uint64_t next_version = 0;
+
+static std::chrono::steady_clock::time_point fresh_deadline() {
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(CACHE_SOFT_TTL_MS);
+}
+
+void cache_put(const std::string& key, SharedBuffer value) {
     auto it = lru_map.find(key);
     if (it != lru_map.end()) {
         // if key exists, update value and move to front to mark as recently used
-        it->second->value = value;
+        it->second->value = std::move(value);
+        it->second->response.reset();
+        it->second->version = ++next_version;
+        it->second->fresh_until = fresh_deadline();
+        it->second->refreshing = false; // any refresh in flight is now outdated
         lru_list.splice(lru_list.begin(), lru_list, it->second); 
     } else {
         // if key is new
@@ -22,21 +33,58 @@ void cache_put(const std::string& key, const std::string& value) {
             last--;
             lru_map.erase(last->key);
             lru_list.pop_back();
+            metrics_count(MetricCounter::CACHE_EVICTIONS);
         }
         // add new entry to front of lru_list
-        lru_list.push_front({key, value});
-        lru_map[key] = lru_list.begin();
+        lru_list.push_front({SlabString(key.data(), key.size()), std::move(value), nullptr, ++next_version, fresh_deadline(), false});
+        lru_map.emplace(lru_list.front().key, lru_list.begin());
+    }
+}
+
+// moves a hit to the front and checks its soft expiry
+static CacheEntry& touch(LruList::iterator entry_it, bool* needs_refresh) {
+    // move the key to front as it is most recently used
+    lru_list.splice(lru_list.begin(), lru_list, entry_it);
+    CacheEntry& entry = *entry_it;
+    if (needs_refresh && CACHE_SOFT_TTL_MS > 0 && !entry.refreshing
+        && std::chrono::steady_clock::now() >= entry.fresh_until) {
+        // stale: serve it anyway, only the first reader triggers a refresh
+        entry.refreshing = true;
+        *needs_refresh = true;
     }
+    return entry;
 }
 
-std::string cache_get(const std::string& key) {
+SharedBuffer cache_get(const std::string& key, bool* needs_refresh) {
     auto it = lru_map.find(key);
     if (it != lru_map.end()) {
-        // if found, move the key to front as it is most recently used
-        lru_list.splice(lru_list.begin(), lru_list, it->second);
-        return it->second->value;
+        metrics_count(MetricCounter::CACHE_HITS);
+        return touch(it->second, needs_refresh).value;
+    }
+    metrics_count(MetricCounter::CACHE_MISSES);
+    return nullptr;
+}
+
+bool cache_lookup(std::string_view key, CacheHit& hit, bool* needs_refresh) {
+    auto it = lru_map.find(key);
+    // a miss here is retried once the request reaches the DB executor, so
+    // callers count misses where they fall through to the database
+    if (it == lru_map.end()) return false;
+    metrics_count(MetricCounter::CACHE_HITS);
+
+    // only reference counts change under the lock, the bytes are shared
+    CacheEntry& entry = touch(it->second, needs_refresh);
+    hit.version = entry.version;
+    hit.value = entry.value;
+    hit.response = entry.response;
+    return true;
+}
+
+void cache_store_response(std::string_view key, uint64_t version, SharedBuffer response) {
+    auto it = lru_map.find(key);
+    if (it != lru_map.end() && it->second->version == version) {
+        it->second->response = std::move(response);
     }
-    return ""; 
 }
 
 void cache_delete(const std::string& key) {
@@ -45,4 +93,28 @@ void cache_delete(const std::string& key) {
         lru_list.erase(it->second);
         lru_map.erase(it);
     }
+}
+
+void cache_apply_refresh(const std::string& key, SharedBuffer value) {
+    auto it = lru_map.find(key);
+    if (it != lru_map.end() && it->second->refreshing) {
+        if (!value) {
+            // key no longer exists in the database
+            lru_list.erase(it->second);
+            lru_map.erase(it);
+            return;
+        }
+        it->second->value = std::move(value);
+        it->second->response.reset();
+        it->second->version = ++next_version;
+        it->second->fresh_until = fresh_deadline();
+        it->second->refreshing = false;
+    }
+}
+
+void cache_cancel_refresh(const std::string& key) {
+    auto it = lru_map.find(key);
+    if (it != lru_map.end()) {
+        it->second->refreshing = false;
+    }
 }
\ No newline at end of file
@@ -5,20 +5,78 @@
 #include <list>
 #include <map>
 #include <mutex>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+#include <string_view>
+
+#include "profiled_mutex.h"
+#include "slab.h"
+
+// immutable, reference-counted buffer; readers keep it alive after the lock is dropped
+// so values and responses are never copied while cache_mutex is held.
+// the buffer and its control block live in the cache's slabs
+using SharedBuffer = std::shared_ptr<const SlabString>;
+
+inline SharedBuffer make_shared_buffer(std::string_view data) {
+    return std::allocate_shared<SlabString>(SlabAllocator<SlabString>(), data.data(), data.size());
+}
+
+// size bytes written in place by fill(char*), for content whose final size is known up front
+template <typename Fill>
+SharedBuffer make_shared_buffer(size_t size, Fill fill) {
+    auto buffer = std::allocate_shared<SlabString>(SlabAllocator<SlabString>(), size, '\0');
+    fill(&(*buffer)[0]);
+    return buffer;
+}
 
 // cache entry struct
 struct CacheEntry {
-    std::string key;
-    std::string value;
+    SlabString key;
+    SharedBuffer value;
+    // fully serialized GET response for this value, built lazily on the first hit
+    SharedBuffer response;
+    uint64_t version; // bumped whenever value changes so a stale response is never attached
+    // soft expiry: past this point the value is still served but a refresh is due
+    std::chrono::steady_clock::time_point fresh_until;
+    bool refreshing;
+};
+
+// lookups by std::string or std::string_view without building a SlabString
+struct CacheKeyLess {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const { return a < b; }
 };
 
-extern std::list<CacheEntry> lru_list;
-extern std::map<std::string, std::list<CacheEntry>::iterator> lru_map;
-extern std::mutex cache_mutex;
+// list and map nodes are allocated from the slabs as well
+using LruList = std::list<CacheEntry, SlabAllocator<CacheEntry>>;
+using LruMap = std::map<SlabString, LruList::iterator, CacheKeyLess,
+                        SlabAllocator<std::pair<const SlabString, LruList::iterator>>>;
+
+extern LruList lru_list;
+extern LruMap lru_map;
+extern ProfiledMutex cache_mutex;
 
 // cache implementation is LRU
-void cache_put(const std::string& key, const std::string& value);
-std::string cache_get(const std::string& key); // returns empty string if not found
+void cache_put(const std::string& key, SharedBuffer value);
+// returns nullptr if not found
+// needs_refresh is set when the entry is stale and the caller is the one that must refresh it
+SharedBuffer cache_get(const std::string& key, bool* needs_refresh = nullptr);
 void cache_delete(const std::string& key);
 
+// result of cache_lookup; response is null until some reader has serialized this value
+struct CacheHit {
+    SharedBuffer value;
+    SharedBuffer response;
+    uint64_t version;
+};
+bool cache_lookup(std::string_view key, CacheHit& hit, bool* needs_refresh = nullptr);
+// attaches a serialized response to the entry if it still holds the value it was built from
+void cache_store_response(std::string_view key, uint64_t version, SharedBuffer response);
+
+// completion of a background refresh; dropped if the key was written or removed meanwhile
+// a null value means the key is gone from the database and the entry is removed
+void cache_apply_refresh(const std::string& key, SharedBuffer value);
+void cache_cancel_refresh(const std::string& key);
+
 #endif
\ No newline at end of file
@@ -2,10 +2,76 @@
 #define SERVER_CONFIG_H
 
 #include <string>
+#include <cstddef>
+#include <cstdint>
 
 // server parameters
 const int SERVER_PORT = 8080;
 const int MAX_CACHE_SIZE = 100;
+// soft expiry: entries older than this are served stale while refreshed in the background (0 = off)
+const int CACHE_SOFT_TTL_MS = 0;
+const int DB_POOL_SIZE = 50;
+const size_t BATCH_MAX_KEYS = 1000;  // keys per /mget or /mset request
+
+// worker pool (WorkStealingPool)
+const size_t WS_QUEUE_CAPACITY = 1024;   // per-worker task queue, power of two
+const int WS_SPIN_ITERATIONS = 100;      // idle polls before a worker parks
+
+// epoll front end
+const int EVENT_LOOP_THREADS = 2;
+const int REUSEPORT_DB_THREADS = 16;              // DB executor in per-core mode, the loops serve cache hits
+const int EVENT_IDLE_TIMEOUT_S = 60;              // idle keep-alive connections are closed after this
+const size_t PIPELINE_MAX_DEPTH = 64;             // pipelined requests per connection in flight or awaiting write
+const size_t HTTP_MAX_HEADER_SIZE = 8192;
+const size_t HTTP_MAX_BODY_SIZE = 1024 * 1024;
+// buffered input per connection is capped at the largest request (header + body, or
+// RESP_MAX_COMMAND_SIZE); beyond that, and while the pipeline is full, the rest waits in the socket
+
+// io_uring front end (uses EVENT_LOOP_THREADS rings)
+const unsigned URING_ENTRIES = 1024;             // submission queue size per ring
+const unsigned URING_RECV_BUFFERS = 1024;        // provided recv buffers per ring, power of two
+const unsigned URING_RECV_BUFFER_SIZE = 4096;
+
+// RESP (Redis protocol) listener for GET/SET/DEL, runs next to the HTTP front end and
+// shares its DB executor. It has no authentication: off unless a port is set (6379 is
+// the Redis default), and bound to loopback unless RESP_HOST says otherwise
+const int RESP_PORT = 0;
+const char* const RESP_HOST = "127.0.0.1";
+const size_t RESP_MAX_ARGS = 1024;
+const size_t RESP_MAX_BULK_SIZE = 1024 * 1024;
+const size_t RESP_MAX_COMMAND_SIZE = 8 * 1024 * 1024; // a whole command, all arguments together
+
+// asynchronous logger
+const size_t LOG_RING_CAPACITY = 16384;      // records waiting for the writer thread, power of two
+const int LOG_FLUSH_INTERVAL_MS = 50;        // max time a record waits before it is written
+const size_t LOG_WRITE_BATCH = 64 * 1024;    // bytes buffered per write to stdout
+const int LOG_LEVEL = 1;                     // 0 debug, 1 info, 2 warn, 3 error; see LOG_COMPILED_LEVEL in logger.h
+const uint32_t ACCESS_LOG_SAMPLE_EVERY = 1;  // log one request in N (1 = all, 0 = none)
+// binary access log of every request (empty = off), files are <path>.000000, .000001, ...
+const std::string ACCESS_LOG_PATH = "";
+const size_t ACCESS_LOG_SEGMENT_RECORDS = 1 << 20;  // 64-byte records per file (64 MB)
+// contention metrics for cache_mutex, pool_mutex and log_mutex at startup; switch at runtime
+// with POST /admin/lock-profiling/on|off
+const bool LOCK_PROFILING = false;
+// slowest requests kept for GET /admin/slow-requests (0 = off), per interval
+const size_t SLOW_LOG_SIZE = 32;
+const int SLOW_LOG_INTERVAL_MS = 60000;
+
+// slab allocator for cache memory
+const size_t SLAB_PAGE_SIZE = 1024 * 1024;  // memory is grabbed from the system in pages of this size
+const size_t SLAB_MIN_CHUNK = 48;           // smallest size class
+const double SLAB_GROWTH_FACTOR = 1.25;     // ratio between consecutive size classes
+
+// DB admission control (adaptive concurrency limit + circuit breaker)
+const int DB_LIMIT_INITIAL = 16;          // concurrent DB calls allowed at startup
+const int DB_LIMIT_MIN = 1;
+const int DB_LIMIT_MAX = DB_POOL_SIZE;
+const double DB_LIMIT_BACKOFF = 0.9;      // multiplicative decrease on slow/failed calls
+const int DB_LATENCY_TARGET_US = 5000;    // calls faster than this grow the limit
+const int DB_ADMIT_WAIT_MS = 50;          // max time a call waits for a slot before 503
+const int DB_SLOW_CALL_MS = 1000;         // slower calls count as breaker failures
+const int DB_BREAKER_FAILURE_THRESHOLD = 5;
+const int DB_BREAKER_OPEN_MS = 2000;      // fail fast for this long before probing
 
 // MySQL Database Configuration
 const std::string DB_HOST = "localhost";
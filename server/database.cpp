@@ -1,6 +1,9 @@
 #include "database.h"
 #include "config.h"
 #include "logger.h"
+#include "db_guard.h"
+#include "metrics.h"
+#include "profiled_mutex.h"
 
 #include <iostream>
 #include <mysql_driver.h>
@@ -10,6 +13,7 @@
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
 
 // --- Connection Pool Implementation ---
 
@@ -24,14 +28,14 @@ public:
                     connection_queue.push(con);
                 }
             }
-            log_message("Connection Pool initialized with " + std::to_string(connection_queue.size()) + " connections.");
+            LOG_INFO("Connection Pool initialized with " + std::to_string(connection_queue.size()) + " connections.");
         } catch (sql::SQLException &e) {
-            log_message("ERROR: Failed to initialize connection pool: " + std::string(e.what()));
+            LOG_ERROR("ERROR: Failed to initialize connection pool: " + std::string(e.what()));
         }
     }
 
     ~ConnectionPool() {
-        std::lock_guard<std::mutex> lock(pool_mutex);
+        std::lock_guard<ProfiledMutex> lock(pool_mutex);
         while (!connection_queue.empty()) {
             delete connection_queue.front();
             connection_queue.pop();
@@ -39,7 +43,7 @@ public:
     }
 
     sql::Connection* getConnection() {
-        std::unique_lock<std::mutex> lock(pool_mutex);
+        std::unique_lock<ProfiledMutex> lock(pool_mutex);
         
         while (connection_queue.empty()) {
             pool_cond.wait(lock);
@@ -69,7 +73,7 @@ public:
 
     void releaseConnection(sql::Connection* con) {
         if (!con) return;
-        std::lock_guard<std::mutex> lock(pool_mutex);
+        std::lock_guard<ProfiledMutex> lock(pool_mutex);
         connection_queue.push(con);
         pool_cond.notify_one();
     }
@@ -77,8 +81,8 @@ public:
 private:
     sql::mysql::MySQL_Driver *driver;
     std::queue<sql::Connection*> connection_queue;
-    std::mutex pool_mutex;
-    std::condition_variable pool_cond;
+    ProfiledMutex pool_mutex{MetricLock::POOL};
+    std::condition_variable_any pool_cond;
 
     sql::Connection* createConnection() {
         try {
@@ -91,10 +95,10 @@ private:
             con->setSchema(DB_NAME);
             return con;
         } catch (std::exception &e) {
-            log_message("ERROR: Could not create MySQL connection: " + std::string(e.what()));
+            LOG_ERROR("ERROR: Could not create MySQL connection: " + std::string(e.what()));
             return nullptr;
         } catch (...) {
-            log_message("ERROR: Unknown error creating MySQL connection");
+            LOG_ERROR("ERROR: Unknown error creating MySQL connection");
             return nullptr;
         }
     }
@@ -110,17 +114,59 @@ void db_init(int pool_size) {
 
 // --- Database Interface Implementation ---
 
+// each thread holds at most one connection at a time, so per-call state is thread local
+static thread_local bool last_call_rejected = false;
+static thread_local bool last_call_failed = false;
+static thread_local bool call_probe = false; // the call is db_guard's half-open probe
+static thread_local std::chrono::steady_clock::time_point call_start;
+static thread_local uint64_t call_connected; // stage_now() once a connection is held
+
 sql::Connection* get_db_connection() {
     if (!global_pool) db_init(10);
-    return global_pool->getConnection();
+
+    last_call_rejected = !db_guard_acquire(call_probe);
+    last_call_failed = last_call_rejected;
+    if (last_call_rejected) {
+        metrics_count(MetricCounter::DB_REJECTED);
+        return nullptr;
+    }
+
+    call_start = std::chrono::steady_clock::now();
+    uint64_t wait_start = stage_now();
+    sql::Connection* con = global_pool->getConnection();
+    metrics_stage_since(MetricStage::POOL_WAIT, wait_start);
+    call_connected = stage_now();
+    if (!con) {
+        last_call_failed = true;
+        metrics_count(MetricCounter::DB_ERRORS);
+        db_guard_release(false, std::chrono::microseconds(0), call_probe);
+    }
+    return con;
 }
 
-void close_db_connection(sql::Connection* conn) {
-    if (global_pool && conn) {
+void close_db_connection(sql::Connection* conn, bool ok) {
+    if (!conn) return;
+
+    if (!ok) last_call_failed = true;
+    auto now = std::chrono::steady_clock::now();
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - call_start);
+    metrics_count(MetricCounter::DB_CALLS);
+    if (!ok) metrics_count(MetricCounter::DB_ERRORS);
+    metrics_stage_since(MetricStage::DB, call_connected);
+    if (global_pool) {
         global_pool->releaseConnection(conn);
-    } else if (conn) {
+    } else {
         delete conn;
     }
+    db_guard_release(ok, latency, call_probe);
+}
+
+bool db_call_rejected() {
+    return last_call_rejected;
+}
+
+bool db_call_failed() {
+    return last_call_failed;
 }
 
 bool db_key_exists(const std::string& key) {
@@ -139,8 +185,8 @@ bool db_key_exists(const std::string& key) {
         }
         close_db_connection(con);
     } catch (sql::SQLException &e) {
-        log_message("DB EXISTS error: " + std::string(e.what()));
-        close_db_connection(con);
+        LOG_ERROR("DB EXISTS error: " + std::string(e.what()));
+        close_db_connection(con, false);
     }
     return exists;
 }
@@ -157,9 +203,12 @@ bool db_create(const std::string& key, const std::string& value) {
         close_db_connection(con);
         return affected_rows > 0;
     } catch (sql::SQLException &e) {
-        close_db_connection(con);
-        if (e.getErrorCode() == 1062) return false; // Duplicate entry
-        log_message("DB CREATE error: " + std::string(e.what()));
+        if (e.getErrorCode() == 1062) { // Duplicate entry, the DB itself is healthy
+            close_db_connection(con);
+            return false;
+        }
+        close_db_connection(con, false);
+        LOG_ERROR("DB CREATE error: " + std::string(e.what()));
         return false;
     }
 }
@@ -176,8 +225,26 @@ bool db_update(const std::string& key, const std::string& value) {
         close_db_connection(con);
         return affected_rows > 0;
     } catch (sql::SQLException &e) {
-        log_message("DB UPDATE error: " + std::string(e.what()));
+        LOG_ERROR("DB UPDATE error: " + std::string(e.what()));
+        close_db_connection(con, false);
+        return false;
+    }
+}
+
+bool db_upsert(const std::string& key, const std::string& value) {
+    sql::Connection *con = get_db_connection();
+    if (!con) return false;
+
+    try {
+        std::unique_ptr<sql::PreparedStatement> pstmt(con->prepareStatement("INSERT INTO key_value_pairs (key_name, value_data) VALUES (?, ?) ON DUPLICATE KEY UPDATE value_data = VALUES(value_data)"));
+        pstmt->setString(1, key);
+        pstmt->setString(2, value);
+        pstmt->executeUpdate(); // 0 affected rows when the value was unchanged
         close_db_connection(con);
+        return true;
+    } catch (sql::SQLException &e) {
+        LOG_ERROR("DB UPSERT error: " + std::string(e.what()));
+        close_db_connection(con, false);
         return false;
     }
 }
@@ -196,12 +263,79 @@ std::string db_read(const std::string& key) {
         }
         close_db_connection(con);
     } catch (sql::SQLException &e) {
-        log_message("DB READ error: " + std::string(e.what()));
-        close_db_connection(con);
+        LOG_ERROR("DB READ error: " + std::string(e.what()));
+        close_db_connection(con, false);
     }
     return value_data;
 }
 
+// "(?, ?, ...)" with n placeholders in groups of width, e.g. "(?, ?), (?, ?)" for n = 2, width = 2
+static std::string placeholders(size_t n, size_t width) {
+    std::string group = "(";
+    for (size_t i = 0; i < width; ++i) group += i == 0 ? "?" : ", ?";
+    group += ")";
+    std::string sql;
+    for (size_t i = 0; i < n; ++i) {
+        if (i > 0) sql += ", ";
+        sql += group;
+    }
+    return sql;
+}
+
+bool db_read_many(const std::vector<std::string>& keys, std::unordered_map<std::string, std::string>& found) {
+    if (keys.empty()) return true;
+    sql::Connection *con = get_db_connection();
+    if (!con) return false;
+
+    try {
+        // one primary key lookup per key that returns the key as requested: key_name
+        // compares case-insensitively, so the stored spelling may differ from it
+        std::string sql;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (i > 0) sql += " UNION ALL ";
+            sql += "SELECT ? AS requested, value_data FROM key_value_pairs WHERE key_name = ?";
+        }
+        std::unique_ptr<sql::PreparedStatement> pstmt(con->prepareStatement(sql));
+        for (size_t i = 0; i < keys.size(); ++i) {
+            pstmt->setString(2 * i + 1, keys[i]);
+            pstmt->setString(2 * i + 2, keys[i]);
+        }
+        std::unique_ptr<sql::ResultSet> res(pstmt->executeQuery());
+        while (res->next()) {
+            found[res->getString("requested")] = res->getString("value_data");
+        }
+        close_db_connection(con);
+        return true;
+    } catch (sql::SQLException &e) {
+        LOG_ERROR("DB READ MANY error: " + std::string(e.what()));
+        close_db_connection(con, false);
+        return false;
+    }
+}
+
+bool db_upsert_many(const std::vector<std::pair<std::string, std::string>>& items) {
+    if (items.empty()) return true;
+    sql::Connection *con = get_db_connection();
+    if (!con) return false;
+
+    try {
+        std::string sql = "INSERT INTO key_value_pairs (key_name, value_data) VALUES " + placeholders(items.size(), 2)
+                        + " ON DUPLICATE KEY UPDATE value_data = VALUES(value_data)";
+        std::unique_ptr<sql::PreparedStatement> pstmt(con->prepareStatement(sql));
+        for (size_t i = 0; i < items.size(); ++i) {
+            pstmt->setString(2 * i + 1, items[i].first);
+            pstmt->setString(2 * i + 2, items[i].second);
+        }
+        pstmt->executeUpdate();
+        close_db_connection(con);
+        return true;
+    } catch (sql::SQLException &e) {
+        LOG_ERROR("DB UPSERT MANY error: " + std::string(e.what()));
+        close_db_connection(con, false);
+        return false;
+    }
+}
+
 bool db_delete(const std::string& key) {
     sql::Connection *con = get_db_connection();
     if (!con) return false;
@@ -213,8 +347,8 @@ bool db_delete(const std::string& key) {
         close_db_connection(con);
         return affected_rows > 0;
     } catch (sql::SQLException &e) {
-        log_message("DB DELETE error: " + std::string(e.what()));
-        close_db_connection(con);
+        LOG_ERROR("DB DELETE error: " + std::string(e.what()));
+        close_db_connection(con, false);
         return false;
     }
 }
\ No newline at end of file
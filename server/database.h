@@ -3,6 +3,9 @@
 
 #include <string>
 #include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <mysql_connection.h>
 #include <cppconn/driver.h>
@@ -14,13 +17,28 @@
 // Initialize the connection pool (New function)
 void db_init(int pool_size);
 
+// returns nullptr if the pool is exhausted or the call was rejected by db_guard
 sql::Connection* get_db_connection();
-void close_db_connection(sql::Connection* conn);
+// ok = false reports a failed call to db_guard
+void close_db_connection(sql::Connection* conn, bool ok = true);
+
+// true if the calling thread's last DB call was shed by db_guard
+// (breaker open or concurrency limit reached), i.e. the result says nothing about the key
+bool db_call_rejected();
+// true if the calling thread's last DB call did not complete: shed, no connection or an
+// SQL error. An empty db_read result means the key is missing only when this is false
+bool db_call_failed();
 
 bool db_key_exists(const std::string& key);
 bool db_create(const std::string& key, const std::string& value);
 bool db_update(const std::string& key, const std::string& value);
+// insert or overwrite
+bool db_upsert(const std::string& key, const std::string& value);
 std::string db_read(const std::string& key);
+// batch variants, one statement each; false on error (nothing is known about the keys)
+// found receives the keys that exist, spelled as in keys; missing keys are simply absent
+bool db_read_many(const std::vector<std::string>& keys, std::unordered_map<std::string, std::string>& found);
+bool db_upsert_many(const std::vector<std::pair<std::string, std::string>>& items);
 bool db_delete(const std::string& key);
 
 #endif
\ No newline at end of file
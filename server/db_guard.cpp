@@ -0,0 +1,135 @@
+#include "db_guard.h"
+#include "config.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+
+namespace {
+
+enum class BreakerState { CLOSED, OPEN, HALF_OPEN };
+
+class DbGuard {
+public:
+    bool acquire(bool& probe) {
+        probe = false;
+        std::unique_lock<std::mutex> lock(guard_mutex);
+        auto now = std::chrono::steady_clock::now();
+
+        if (state == BreakerState::OPEN) {
+            if (now < open_until) return false; // fail fast
+            // cooldown elapsed, let a single probe through
+            state = BreakerState::HALF_OPEN;
+            probe_in_flight = false;
+        }
+
+        if (state == BreakerState::HALF_OPEN) {
+            if (probe_in_flight) return false;
+            probe_in_flight = true;
+            probe = true;
+            in_flight++;
+            return true;
+        }
+
+        // closed: wait briefly for a slot under the current limit
+        bool admitted = guard_cond.wait_for(lock, std::chrono::milliseconds(DB_ADMIT_WAIT_MS), [this] {
+            return state != BreakerState::CLOSED || in_flight < static_cast<int>(limit);
+        });
+        if (!admitted || state != BreakerState::CLOSED) return false;
+
+        in_flight++;
+        return true;
+    }
+
+    void release(bool ok, std::chrono::microseconds latency, bool probe) {
+        std::string transition;
+        {
+            std::lock_guard<std::mutex> lock(guard_mutex);
+            auto now = std::chrono::steady_clock::now();
+            in_flight--;
+
+            // a call that takes longer than DB_SLOW_CALL_MS counts as a failure for the breaker
+            bool healthy = ok && latency <= std::chrono::milliseconds(DB_SLOW_CALL_MS);
+
+            // calls admitted before the breaker opened may finish while half-open, only the probe counts
+            if (state == BreakerState::HALF_OPEN && probe) {
+                probe_in_flight = false;
+                if (healthy) {
+                    state = BreakerState::CLOSED;
+                    consecutive_failures = 0;
+                    transition = "closed (probe succeeded)";
+                } else {
+                    state = BreakerState::OPEN;
+                    open_until = now + std::chrono::milliseconds(DB_BREAKER_OPEN_MS);
+                    transition = "open (probe failed)";
+                }
+            } else if (state == BreakerState::CLOSED) {
+                consecutive_failures = healthy ? 0 : consecutive_failures + 1;
+                if (consecutive_failures >= DB_BREAKER_FAILURE_THRESHOLD) {
+                    state = BreakerState::OPEN;
+                    open_until = now + std::chrono::milliseconds(DB_BREAKER_OPEN_MS);
+                    transition = "open (" + std::to_string(consecutive_failures) + " consecutive failures)";
+                }
+            }
+
+            // AIMD: grow by one slot per "round" of fast calls, shrink multiplicatively
+            // at most once per target latency window when calls are slow or fail
+            if (ok && latency <= std::chrono::microseconds(DB_LATENCY_TARGET_US)) {
+                limit = std::min<double>(DB_LIMIT_MAX, limit + 1.0 / limit);
+            } else if (now - last_decrease >= std::chrono::microseconds(DB_LATENCY_TARGET_US)) {
+                limit = std::max<double>(DB_LIMIT_MIN, limit * DB_LIMIT_BACKOFF);
+                last_decrease = now;
+            }
+        }
+        guard_cond.notify_all();
+
+        if (!transition.empty()) {
+            LOG_WARN("DB circuit breaker " + transition);
+        }
+    }
+
+    double current_limit() {
+        std::lock_guard<std::mutex> lock(guard_mutex);
+        return limit;
+    }
+
+    bool is_open() {
+        std::lock_guard<std::mutex> lock(guard_mutex);
+        return state == BreakerState::OPEN;
+    }
+
+private:
+    std::mutex guard_mutex;
+    std::condition_variable guard_cond;
+
+    double limit = DB_LIMIT_INITIAL;
+    int in_flight = 0;
+    std::chrono::steady_clock::time_point last_decrease;
+
+    BreakerState state = BreakerState::CLOSED;
+    int consecutive_failures = 0;
+    bool probe_in_flight = false;
+    std::chrono::steady_clock::time_point open_until;
+};
+
+DbGuard guard;
+
+}
+
+bool db_guard_acquire(bool& probe) {
+    return guard.acquire(probe);
+}
+
+void db_guard_release(bool ok, std::chrono::microseconds latency, bool probe) {
+    guard.release(ok, latency, probe);
+}
+
+double db_guard_limit() {
+    return guard.current_limit();
+}
+
+bool db_guard_is_open() {
+    return guard.is_open();
+}
@@ -0,0 +1,21 @@
+#ifndef SERVER_DB_GUARD_H
+#define SERVER_DB_GUARD_H
+
+#include <chrono>
+
+// Admission control in front of the MySQL connection pool.
+// An AIMD concurrency limit driven by observed DB latency decides how many
+// calls may be in flight, and a circuit breaker fails calls fast while the
+// DB is unhealthy so they do not queue behind doomed requests.
+
+// returns false if the call must be rejected (breaker open or limit reached);
+// probe is set when the call is the half-open breaker's probe
+bool db_guard_acquire(bool& probe);
+// reports the outcome of an admitted call, with the probe flag acquire set;
+// while half-open only the probe's outcome decides the breaker state
+void db_guard_release(bool ok, std::chrono::microseconds latency, bool probe);
+
+double db_guard_limit();
+bool db_guard_is_open();
+
+#endif
@@ -0,0 +1,514 @@
+#include "event_server.h"
+#include "config.h"
+#include "http_codec.h"
+#include "kv_service.h"
+#include "logger.h"
+#include "metrics.h"
+#include "resp_codec.h"
+#include "resp_service.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+static const int MAX_EVENTS = 256;
+static const int FLUSH_MAX_IOV = 64; // responses per sendmsg
+
+static std::string peer_string(const sockaddr_storage& addr) {
+    char host[INET6_ADDRSTRLEN] = {0};
+    int port = 0;
+    if (addr.ss_family == AF_INET) {
+        auto* in4 = reinterpret_cast<const sockaddr_in*>(&addr);
+        inet_ntop(AF_INET, &in4->sin_addr, host, sizeof(host));
+        port = ntohs(in4->sin_port);
+    } else if (addr.ss_family == AF_INET6) {
+        auto* in6 = reinterpret_cast<const sockaddr_in6*>(&addr);
+        inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+        port = ntohs(in6->sin6_port);
+    }
+    return std::string(host) + ":" + std::to_string(port);
+}
+
+// CPUs this process may run on (respects taskset), used for pinning in per-core mode
+static std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+EventServer::EventServer(int num_loops, httplib::TaskQueue& workers, bool per_core, Protocol protocol)
+    : num_loops(num_loops), per_core(per_core), protocol(protocol),
+      max_input(protocol == Protocol::RESP ? RESP_MAX_COMMAND_SIZE : HTTP_MAX_HEADER_SIZE + HTTP_MAX_BODY_SIZE),
+      workers(workers) {
+}
+
+EventServer::~EventServer() {
+    for (auto& loop : loops) {
+        if (loop->epoll_fd >= 0) close(loop->epoll_fd);
+        if (loop->wake_fd >= 0) close(loop->wake_fd);
+        if (per_core && loop->listen_fd >= 0) close(loop->listen_fd);
+    }
+    if (listen_fd >= 0) close(listen_fd);
+}
+
+int EventServer::open_listener(const std::string& host, int port, bool reuseport) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("ERROR: socket() failed: " + std::string(strerror(errno)));
+        return -1;
+    }
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    if (reuseport) {
+        // the kernel spreads incoming connections across all sockets bound to the port
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes));
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+        LOG_ERROR("ERROR: bind/listen failed: " + std::string(strerror(errno)));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool EventServer::listen(const std::string& host, int port) {
+    if (!per_core) {
+        listen_fd = open_listener(host, port, false);
+        if (listen_fd < 0) return false;
+    }
+
+    std::vector<int> cpus = allowed_cpus();
+    for (int i = 0; i < num_loops; ++i) {
+        std::unique_ptr<Loop> loop(new Loop());
+        if (per_core) {
+            loop->listen_fd = open_listener(host, port, true);
+            if (loop->listen_fd < 0) return false;
+            if (!cpus.empty()) loop->cpu = cpus[i % cpus.size()];
+        } else {
+            loop->listen_fd = listen_fd;
+        }
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop->epoll_fd < 0 || loop->wake_fd < 0) {
+            LOG_ERROR("ERROR: epoll/eventfd setup failed: " + std::string(strerror(errno)));
+            return false;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = loop->wake_fd;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &ev);
+
+        // shared mode: every loop watches the one listening socket,
+        // EPOLLEXCLUSIVE wakes only one of them per connection
+        ev.events = per_core ? EPOLLIN : EPOLLIN | EPOLLEXCLUSIVE;
+        ev.data.fd = loop->listen_fd;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->listen_fd, &ev);
+
+        loops.push_back(std::move(loop));
+    }
+
+    for (auto& loop : loops) {
+        Loop* l = loop.get();
+        l->thread = std::thread([this, l] { run_loop(*l); });
+        if (l->cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(l->cpu, &set);
+            if (pthread_setaffinity_np(l->thread.native_handle(), sizeof(set), &set) != 0) {
+                LOG_WARN("WARNING: could not pin event loop to CPU " + std::to_string(l->cpu));
+            }
+        }
+    }
+    for (auto& loop : loops) {
+        loop->thread.join();
+    }
+    return true;
+}
+
+void EventServer::run_loop(Loop& loop) {
+    epoll_event events[MAX_EVENTS];
+    auto last_sweep = std::chrono::steady_clock::now();
+
+    for (;;) {
+        int n = epoll_wait(loop.epoll_fd, events, MAX_EVENTS, 1000);
+        if (n < 0 && errno != EINTR) {
+            LOG_ERROR("ERROR: epoll_wait failed: " + std::string(strerror(errno)));
+            return;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == loop.listen_fd) {
+                accept_connections(loop);
+                continue;
+            }
+            if (fd == loop.wake_fd) {
+                uint64_t count;
+                while (read(loop.wake_fd, &count, sizeof(count)) > 0) {}
+                drain_completions(loop);
+                continue;
+            }
+
+            auto it = loop.connections.find(fd);
+            if (it == loop.connections.end()) continue;
+            ConnectionPtr conn = it->second;
+
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                on_readable(loop, conn);
+            }
+            if (!conn->closed && (events[i].events & EPOLLOUT)) {
+                process(loop, conn); // flushes, then parses requests held back by a full pipeline
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_sweep >= std::chrono::seconds(1)) {
+            close_idle(loop);
+            last_sweep = now;
+        }
+    }
+}
+
+void EventServer::accept_connections(Loop& loop) {
+    for (;;) {
+        sockaddr_storage addr{};
+        socklen_t len = sizeof(addr);
+        int fd = accept4(loop.listen_fd, reinterpret_cast<sockaddr*>(&addr), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("ERROR: accept failed: " + std::string(strerror(errno)));
+            }
+            return;
+        }
+
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+        ConnectionPtr conn = std::make_shared<Connection>();
+        conn->fd = fd;
+        conn->loop = &loop;
+        conn->client = peer_string(addr);
+        conn->last_active = std::chrono::steady_clock::now();
+
+        // edge triggered: reads and writes always run until EAGAIN
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            continue;
+        }
+        loop.connections[fd] = std::move(conn);
+    }
+}
+
+void EventServer::on_readable(Loop& loop, const ConnectionPtr& conn) {
+    read_input(loop, conn);
+    if (!conn->closed) process(loop, conn);
+}
+
+// reads until EAGAIN, but stops while the pipeline is full or max_input is buffered and
+// leaves the rest in the socket, so TCP flow control holds the peer back. Edge triggered,
+// no new event comes for that data: process() resumes reading once there is room.
+void EventServer::read_input(Loop& loop, const ConnectionPtr& conn) {
+    char buf[16384];
+    conn->read_paused = false;
+    while (!conn->peer_closed) {
+        if (!can_read(*conn)) {
+            conn->read_paused = true;
+            break;
+        }
+        ssize_t n = recv(conn->fd, buf, std::min(sizeof(buf), max_input - conn->in.size()), 0);
+        if (n > 0) {
+            conn->in.append(buf, n);
+            continue;
+        }
+        if (n == 0) {
+            // half close (shutdown(SHUT_WR), HTTP/1.0 style clients): the requests
+            // already read are still answered, process() closes once they are written
+            conn->peer_closed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            close_connection(loop, conn); // the socket failed, nobody can read a response
+            return;
+        }
+        break;
+    }
+    conn->last_active = std::chrono::steady_clock::now();
+}
+
+bool EventServer::can_read(const Connection& conn) const {
+    return conn.slots.size() < PIPELINE_MAX_DEPTH && conn.in.size() < max_input;
+}
+
+void EventServer::process(Loop& loop, const ConnectionPtr& conn) {
+    run_pipeline(loop, conn);
+    // requests finished or input was consumed: read what was held back in the socket
+    while (!conn->closed && conn->read_paused && can_read(*conn)) {
+        read_input(loop, conn);
+        if (!conn->closed) run_pipeline(loop, conn);
+    }
+}
+
+void EventServer::run_pipeline(Loop& loop, const ConnectionPtr& conn) {
+    for (;;) {
+        while (!conn->close_after_write && !conn->closed && conn->slots.size() < PIPELINE_MAX_DEPTH) {
+            bool started = protocol == Protocol::RESP ? process_resp(conn) : process_http(conn);
+            if (!started) {
+                flush(loop, conn);
+                if (!conn->closed && conn->slots.empty()) {
+                    // a half-closed peer sends nothing more: close once everything it sent is answered;
+                    // a full buffer with no complete request in it is larger than any valid request
+                    if (conn->peer_closed || conn->in.size() >= max_input) close_connection(loop, conn);
+                }
+                return;
+            }
+        }
+        size_t pending = conn->slots.size();
+        flush(loop, conn);
+        // the pipeline was full; go on parsing only if the flush made room
+        if (conn->closed || conn->close_after_write || conn->slots.size() == pending) return;
+    }
+}
+
+bool EventServer::process_http(const ConnectionPtr& conn) {
+    HttpRequest req;
+    size_t consumed = 0;
+    uint64_t parse_start = stage_now();
+    ParseStatus status = parse_http_request(conn->in, req, consumed);
+    if (status == ParseStatus::INCOMPLETE) return false;
+    uint64_t parse_ns = stage_elapsed_ns(parse_start);
+    if (status == ParseStatus::BAD) {
+        KvResponse res;
+        res.status = 400;
+        res.content_type.clear();
+        complete_slot(*conn, add_slot(*conn), http_slot(res, false));
+        conn->close_after_write = true;
+        return false;
+    }
+
+    bool write = !route_is_read_only(match_route(req.method, req.path).route);
+    if (!may_start(*conn, write)) return false; // stays buffered until the requests before it finish
+    conn->in.erase(0, consumed);
+    metrics_stage(MetricStage::PARSE, parse_ns); // counted once, a held back request is parsed again
+    uint64_t seq = add_slot(*conn);
+    if (!req.keep_alive) conn->close_after_write = true;
+
+    KvResponse res;
+    KvFormats formats = kv_negotiate(req.content_type, req.accept);
+    if (!write && kv_dispatch_cached(req.method, req.path, conn->client, res, formats.response)) {
+        // fast lane: cache hit, answered right here
+        complete_slot(*conn, seq, http_slot(res, req.keep_alive));
+        return true;
+    }
+
+    // misses and writes go to the DB executor
+    run_on_executor(conn, seq, write, [conn, req = std::move(req), formats, write]() {
+        return http_slot(kv_dispatch(req.method, req.path, req.body, conn->client, formats, !write), req.keep_alive);
+    });
+    return true;
+}
+
+bool EventServer::process_resp(const ConnectionPtr& conn) {
+    std::vector<std::string> args;
+    size_t consumed = 0;
+    uint64_t parse_start = stage_now();
+    ParseStatus status = parse_resp_command(conn->in, args, consumed);
+    if (status == ParseStatus::INCOMPLETE) return false;
+    uint64_t parse_ns = stage_elapsed_ns(parse_start);
+    if (status == ParseStatus::BAD) {
+        complete_slot(*conn, add_slot(*conn), raw_slot(resp_error("Protocol error")));
+        conn->close_after_write = true;
+        return false;
+    }
+
+    bool write = !resp_is_read_only(args);
+    if (!may_start(*conn, write)) return false;
+    conn->in.erase(0, consumed);
+    metrics_stage(MetricStage::PARSE, parse_ns);
+    uint64_t seq = add_slot(*conn);
+
+    std::string reply;
+    if (!write && resp_execute_cached(args, conn->client, reply)) {
+        complete_slot(*conn, seq, raw_slot(std::move(reply)));
+        return true;
+    }
+
+    run_on_executor(conn, seq, write, [conn, args = std::move(args), write]() {
+        return raw_slot(resp_execute(args, conn->client, !write));
+    });
+    return true;
+}
+
+// reads run side by side; a write runs alone, so pipelined requests see each other's effects in order
+bool EventServer::may_start(const Connection& conn, bool write) {
+    return write ? conn.running == 0 : !conn.write_running;
+}
+
+uint64_t EventServer::add_slot(Connection& conn) {
+    conn.slots.emplace_back();
+    return conn.first_seq + conn.slots.size() - 1;
+}
+
+void EventServer::complete_slot(Connection& conn, uint64_t seq, Slot response) {
+    Slot& slot = conn.slots[seq - conn.first_seq];
+    slot = std::move(response);
+    slot.ready = true;
+}
+
+// a shared body (a cache hit) stays where it is, only the head is formatted
+EventServer::Slot EventServer::http_slot(const KvResponse& res, bool keep_alive) {
+    Slot slot;
+    slot.head = format_http_head(res, keep_alive);
+    if (res.shared_body) {
+        slot.body = res.shared_body;
+    } else {
+        slot.head += res.body;
+    }
+    return slot;
+}
+
+EventServer::Slot EventServer::raw_slot(std::string data) {
+    Slot slot;
+    slot.head = std::move(data);
+    return slot;
+}
+
+void EventServer::run_on_executor(const ConnectionPtr& conn, uint64_t seq, bool write, std::function<Slot()> handler) {
+    conn->running++;
+    if (write) conn->write_running = true;
+    metrics_trace_reset(); // the parse time traced here must not reach the loop's next request
+    workers.enqueue([conn, seq, write, handler = std::move(handler)]() {
+        Slot response = handler();
+        // hand the response back to the connection's loop
+        Loop& owner = *conn->loop;
+        {
+            std::lock_guard<std::mutex> lock(owner.done_mutex);
+            owner.done.push_back({conn, seq, std::move(response), write});
+        }
+        uint64_t one = 1;
+        ssize_t ignored = ::write(owner.wake_fd, &one, sizeof(one));
+        (void)ignored;
+    });
+}
+
+void EventServer::drain_completions(Loop& loop) {
+    std::vector<Completion> done;
+    {
+        std::lock_guard<std::mutex> lock(loop.done_mutex);
+        done.swap(loop.done);
+    }
+
+    for (Completion& c : done) {
+        ConnectionPtr& conn = c.conn;
+        if (conn->closed) continue; // peer went away while the request was being handled
+
+        conn->running--;
+        if (c.write) conn->write_running = false;
+        complete_slot(*conn, c.seq, std::move(c.response));
+        conn->last_active = std::chrono::steady_clock::now();
+        process(loop, conn); // held-back pipelined requests may start now, then flush
+    }
+}
+
+// sends the ready responses at the front of the pipeline, several per syscall;
+// each one is its head plus, if there is one, the borrowed body
+void EventServer::flush(Loop& loop, const ConnectionPtr& conn) {
+    while (!conn->closed && !conn->slots.empty() && conn->slots.front().ready) {
+        iovec iov[FLUSH_MAX_IOV];
+        int count = 0;
+        size_t skip = conn->out_offset;
+        for (auto it = conn->slots.begin(); it != conn->slots.end() && it->ready && count + 2 <= FLUSH_MAX_IOV; ++it) {
+            if (skip < it->head.size()) {
+                iov[count].iov_base = const_cast<char*>(it->head.data()) + skip;
+                iov[count].iov_len = it->head.size() - skip;
+                ++count;
+                skip = 0;
+            } else {
+                skip -= it->head.size();
+            }
+            if (it->body && skip < it->body->size()) {
+                iov[count].iov_base = const_cast<char*>(it->body->data()) + skip;
+                iov[count].iov_len = it->body->size() - skip;
+                ++count;
+            }
+            skip = 0;
+        }
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        uint64_t write_start = stage_now();
+        ssize_t n = count > 0 ? sendmsg(conn->fd, &msg, MSG_NOSIGNAL) : 0;
+        if (n > 0) metrics_stage_since(MetricStage::WRITE, write_start);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return; // EPOLLOUT resumes
+        if (n < 0) {
+            close_connection(loop, conn);
+            return;
+        }
+
+        // drop what was sent; a partially sent response stays at the front
+        size_t sent = n;
+        while (!conn->slots.empty() && conn->slots.front().ready) {
+            size_t remaining = conn->slots.front().size() - conn->out_offset;
+            if (sent < remaining) {
+                conn->out_offset += sent;
+                break;
+            }
+            sent -= remaining;
+            conn->slots.pop_front();
+            conn->first_seq++;
+            conn->out_offset = 0;
+        }
+    }
+
+    if (conn->close_after_write && conn->slots.empty()) {
+        close_connection(loop, conn);
+    }
+}
+
+void EventServer::close_connection(Loop& loop, const ConnectionPtr& conn) {
+    if (conn->closed) return;
+    conn->closed = true;
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    close(conn->fd);
+    loop.connections.erase(conn->fd);
+}
+
+void EventServer::close_idle(Loop& loop) {
+    auto deadline = std::chrono::steady_clock::now() - std::chrono::seconds(EVENT_IDLE_TIMEOUT_S);
+    std::vector<ConnectionPtr> idle;
+    for (auto& entry : loop.connections) {
+        const Connection& conn = *entry.second;
+        if (conn.running == 0 && conn.slots.empty() && conn.last_active < deadline) idle.push_back(entry.second);
+    }
+    for (auto& conn : idle) {
+        close_connection(loop, conn);
+    }
+}
\ No newline at end of file
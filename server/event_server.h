@@ -0,0 +1,130 @@
+#ifndef SERVER_EVENT_SERVER_H
+#define SERVER_EVENT_SERVER_H
+
+#include "cache.h"
+#include "httplib.h"
+#include "kv_service.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Event-driven HTTP front end: non-blocking sockets and epoll.
+// A few event loop threads own all connections, read and parse requests,
+// and answer cache hits themselves; only requests that need the database
+// go to the worker pool (the DB executor), so hits never queue behind
+// MySQL calls. Idle keep-alive connections cost a few hundred bytes
+// instead of a worker thread.
+//
+// In per-core mode every loop has its own SO_REUSEPORT listening socket
+// and is pinned to one CPU, so loops share nothing on the fast path but
+// the cache: no common accept queue.
+//
+// Pipelined requests are parsed as they arrive and may run concurrently:
+// reads run side by side, a write waits for everything before it and
+// holds back everything after it. Responses are written strictly in
+// request order, as many as are ready in one vectored send.
+//
+// The same machinery serves the RESP listener (Protocol::RESP): only the
+// request parsing and the command handling differ.
+
+class EventServer {
+public:
+    enum class Protocol { HTTP, RESP };
+
+    // workers is the DB executor; it is not owned and may be shared with another server
+    EventServer(int num_loops, httplib::TaskQueue& workers, bool per_core = false, Protocol protocol = Protocol::HTTP);
+    ~EventServer();
+
+    // blocks serving requests; returns false if the socket could not be set up
+    bool listen(const std::string& host, int port);
+
+private:
+    struct Loop;
+
+    // response to one pipelined request, in arrival order
+    struct Slot {
+        std::string head;  // HTTP status line + headers, or the whole response
+        SharedBuffer body; // borrowed (e.g. from the cache) and sent after head without a copy
+        bool ready = false;
+
+        size_t size() const { return head.size() + (body ? body->size() : 0); }
+    };
+
+    struct Connection {
+        int fd;
+        Loop* loop;
+        std::string client; // "addr:port" for the access log
+        std::string in;
+        std::deque<Slot> slots;     // requests not fully written yet, oldest first
+        uint64_t first_seq = 0;     // sequence number of slots.front()
+        size_t out_offset = 0;      // bytes of slots.front() already sent, head and body together
+        int running = 0;            // requests with the DB executor
+        bool write_running = false; // one of them changes data
+        bool close_after_write = false; // no more requests are read, close once the slots are written
+        bool peer_closed = false;   // peer shut down its side: answer what it sent, then close
+        bool read_paused = false;   // stopped reading with data left in the socket (see read_input)
+        bool closed = false;
+        std::chrono::steady_clock::time_point last_active;
+    };
+    using ConnectionPtr = std::shared_ptr<Connection>;
+
+    struct Completion {
+        ConnectionPtr conn;
+        uint64_t seq;
+        Slot response;
+        bool write;
+    };
+
+    struct Loop {
+        int listen_fd = -1;
+        int cpu = -1; // pinned CPU in per-core mode
+        int epoll_fd = -1;
+        int wake_fd = -1; // eventfd, signalled when workers post completions
+        std::thread thread;
+        std::unordered_map<int, ConnectionPtr> connections;
+
+        std::mutex done_mutex;
+        std::vector<Completion> done;
+    };
+
+    int num_loops;
+    bool per_core;
+    Protocol protocol;
+    int listen_fd = -1; // shared by all loops unless per_core
+    std::vector<std::unique_ptr<Loop>> loops;
+    size_t max_input; // buffered input per connection, the largest request the protocol allows
+    httplib::TaskQueue& workers; // DB executor
+
+    static int open_listener(const std::string& host, int port, bool reuseport);
+
+    void run_loop(Loop& loop);
+    void accept_connections(Loop& loop);
+    void on_readable(Loop& loop, const ConnectionPtr& conn);
+    void read_input(Loop& loop, const ConnectionPtr& conn);
+    bool can_read(const Connection& conn) const;
+    void process(Loop& loop, const ConnectionPtr& conn);
+    void run_pipeline(Loop& loop, const ConnectionPtr& conn);
+    // start the next buffered request; false when there is none or it has to wait
+    bool process_http(const ConnectionPtr& conn);
+    bool process_resp(const ConnectionPtr& conn);
+    static bool may_start(const Connection& conn, bool write);
+    static uint64_t add_slot(Connection& conn);
+    static void complete_slot(Connection& conn, uint64_t seq, Slot response);
+    void run_on_executor(const ConnectionPtr& conn, uint64_t seq, bool write, std::function<Slot()> handler);
+    static Slot http_slot(const KvResponse& res, bool keep_alive);
+    static Slot raw_slot(std::string data);
+    void flush(Loop& loop, const ConnectionPtr& conn);
+    void drain_completions(Loop& loop);
+    void close_connection(Loop& loop, const ConnectionPtr& conn);
+    void close_idle(Loop& loop);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "http_codec.h"
+#include "config.h"
+#include "httplib.h"
+
+#include <cstring>
+#include <strings.h>
+
+static bool header_is(const std::string& line, size_t name_len, const char* name) {
+    return name_len == std::strlen(name) && strncasecmp(line.data(), name, name_len) == 0;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// same decoding httplib applies to req.path before matching routes
+static std::string decode_path(const std::string& target) {
+    std::string path;
+    path.reserve(target.size());
+    for (size_t i = 0; i < target.size(); ++i) {
+        if (target[i] == '%' && i + 2 < target.size() && hex_value(target[i + 1]) >= 0 && hex_value(target[i + 2]) >= 0) {
+            path += static_cast<char>(hex_value(target[i + 1]) * 16 + hex_value(target[i + 2]));
+            i += 2;
+        } else {
+            path += target[i];
+        }
+    }
+    return path;
+}
+
+ParseStatus parse_http_request(const std::string& buf, HttpRequest& req, size_t& consumed) {
+    size_t header_end = buf.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        return buf.size() > HTTP_MAX_HEADER_SIZE ? ParseStatus::BAD : ParseStatus::INCOMPLETE;
+    }
+    if (header_end + 4 > HTTP_MAX_HEADER_SIZE) return ParseStatus::BAD;
+
+    // request line: METHOD SP target SP version
+    size_t line_end = buf.find("\r\n");
+    size_t sp1 = buf.find(' ');
+    size_t sp2 = sp1 == std::string::npos ? sp1 : buf.find(' ', sp1 + 1);
+    if (sp2 == std::string::npos || sp2 > line_end) return ParseStatus::BAD;
+
+    req.method = buf.substr(0, sp1);
+    std::string target = buf.substr(sp1 + 1, sp2 - sp1 - 1);
+    std::string version = buf.substr(sp2 + 1, line_end - sp2 - 1);
+    if (version == "HTTP/1.1") {
+        req.keep_alive = true;
+    } else if (version == "HTTP/1.0") {
+        req.keep_alive = false;
+    } else {
+        return ParseStatus::BAD;
+    }
+    req.path = decode_path(target.substr(0, target.find('?')));
+
+    size_t content_length = 0;
+    size_t pos = line_end + 2;
+    while (pos < header_end) {
+        size_t eol = buf.find("\r\n", pos);
+        std::string line = buf.substr(pos, eol - pos);
+        pos = eol + 2;
+
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) return ParseStatus::BAD;
+        size_t value_start = line.find_first_not_of(" \t", colon + 1);
+        std::string value = value_start == std::string::npos ? "" : line.substr(value_start);
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.pop_back();
+
+        if (header_is(line, colon, "Content-Length")) {
+            char* end = nullptr;
+            unsigned long long len = std::strtoull(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || len > HTTP_MAX_BODY_SIZE) return ParseStatus::BAD;
+            content_length = static_cast<size_t>(len);
+        } else if (header_is(line, colon, "Connection")) {
+            if (strcasecmp(value.c_str(), "close") == 0) req.keep_alive = false;
+            if (strcasecmp(value.c_str(), "keep-alive") == 0) req.keep_alive = true;
+        } else if (header_is(line, colon, "Content-Type")) {
+            req.content_type = value;
+        } else if (header_is(line, colon, "Accept")) {
+            req.accept = value;
+        } else if (header_is(line, colon, "Transfer-Encoding")) {
+            return ParseStatus::BAD;
+        }
+    }
+
+    size_t body_start = header_end + 4;
+    if (buf.size() < body_start + content_length) return ParseStatus::INCOMPLETE;
+
+    req.body = buf.substr(body_start, content_length);
+    consumed = body_start + content_length;
+    return ParseStatus::OK;
+}
+
+std::string format_http_head(const KvResponse& res, bool keep_alive) {
+    std::string out;
+    out.reserve(128);
+    out += "HTTP/1.1 ";
+    out += std::to_string(res.status);
+    out += ' ';
+    out += httplib::status_message(res.status);
+    out += "\r\n";
+    if (!res.content_type.empty()) {
+        out += "Content-Type: " + res.content_type + "\r\n";
+    }
+    out += "Content-Length: " + std::to_string(res.body_view().size()) + "\r\n";
+    for (const auto& header : res.headers) {
+        out += header.first + ": " + header.second + "\r\n";
+    }
+    if (!keep_alive) out += "Connection: close\r\n";
+    out += "\r\n";
+    return out;
+}
+
+std::string format_http_response(const KvResponse& res, bool keep_alive) {
+    std::string out = format_http_head(res, keep_alive);
+    std::string_view body = res.body_view();
+    out.append(body.data(), body.size());
+    return out;
+}
@@ -0,0 +1,31 @@
+#ifndef SERVER_HTTP_CODEC_H
+#define SERVER_HTTP_CODEC_H
+
+#include "kv_service.h"
+
+#include <string>
+
+// Minimal HTTP/1.1 request parser and response formatter for the
+// front ends that do their own socket I/O (see event_server.h).
+// Bodies must use Content-Length; chunked requests are rejected.
+
+struct HttpRequest {
+    std::string method;
+    std::string path;   // percent-decoded, without the query string
+    std::string body;
+    std::string content_type;
+    std::string accept;
+    bool keep_alive = true;
+};
+
+enum class ParseStatus { INCOMPLETE, OK, BAD };
+
+// parses one request from the front of buf; on OK, consumed is the number of bytes it used
+ParseStatus parse_http_request(const std::string& buf, HttpRequest& req, size_t& consumed);
+
+// status line + headers + blank line, followed by the body
+std::string format_http_response(const KvResponse& res, bool keep_alive);
+// status line + headers + blank line only, for writers that send the body from its own buffer
+std::string format_http_head(const KvResponse& res, bool keep_alive);
+
+#endif
\ No newline at end of file
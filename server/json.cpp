@@ -0,0 +1,418 @@
+#include "json.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// first byte at or after pos that ends or interrupts a string body: '"', '\\' or a control character
+static size_t find_string_special(std::string_view s, size_t pos) {
+    const char* data = s.data();
+    size_t size = s.size();
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1f);
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+        // unsigned chunk <= 0x1f
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(chunk, control_max), chunk));
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0) return pos + __builtin_ctz(mask);
+    }
+#endif
+    for (; pos < size; ++pos) {
+        unsigned char c = data[pos];
+        if (c == '"' || c == '\\' || c < 0x20) return pos;
+    }
+    return size;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool read_hex4(std::string_view s, size_t pos, unsigned& value) {
+    if (pos + 4 > s.size()) return false;
+    value = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+        int d = hex_digit(s[i]);
+        if (d < 0) return false;
+        value = value * 16 + d;
+    }
+    return true;
+}
+
+static void append_utf8(std::string& out, unsigned cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xc0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xe0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (cp & 0x3f));
+    }
+}
+
+bool json_unescape(std::string_view raw, std::string& out) {
+    out.clear();
+    out.reserve(raw.size());
+    size_t pos = 0;
+    while (pos < raw.size()) {
+        size_t next = raw.find('\\', pos);
+        if (next == std::string_view::npos) next = raw.size();
+        out.append(raw.data() + pos, next - pos);
+        if (next == raw.size()) break;
+        if (next + 1 >= raw.size()) return false;
+
+        char c = raw[next + 1];
+        pos = next + 2;
+        switch (c) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                unsigned cp;
+                if (!read_hex4(raw, pos, cp)) return false;
+                pos += 4;
+                if (cp >= 0xd800 && cp <= 0xdbff) {
+                    // high surrogate, must be followed by \uDC00-\uDFFF
+                    unsigned low;
+                    if (pos + 2 > raw.size() || raw[pos] != '\\' || raw[pos + 1] != 'u'
+                        || !read_hex4(raw, pos + 2, low) || low < 0xdc00 || low > 0xdfff) {
+                        return false;
+                    }
+                    pos += 6;
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                } else if (cp >= 0xdc00 && cp <= 0xdfff) {
+                    return false;
+                }
+                append_utf8(out, cp);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+std::string JsonString::str() const {
+    if (!escaped) return std::string(raw);
+    std::string out;
+    json_unescape(raw, out); // validated by the reader
+    return out;
+}
+
+bool JsonString::equals(std::string_view s) const {
+    if (!escaped) return raw == s;
+    return str() == s;
+}
+
+bool JsonReader::fail() {
+    error = true;
+    return false;
+}
+
+char JsonReader::peek() {
+    while (pos < doc.size() && (doc[pos] == ' ' || doc[pos] == '\t' || doc[pos] == '\n' || doc[pos] == '\r')) ++pos;
+    return pos < doc.size() ? doc[pos] : 0;
+}
+
+bool JsonReader::consume(char c) {
+    if (error || peek() != c) return false;
+    ++pos;
+    return true;
+}
+
+// enters a container one level below the current one
+bool JsonReader::open(char c) {
+    if (!consume(c) || depth == MAX_DEPTH) return fail();
+    first[++depth] = true;
+    return true;
+}
+
+bool JsonReader::begin_object() {
+    return open('{');
+}
+
+bool JsonReader::begin_array() {
+    return open('[');
+}
+
+// handles the comma or the closing bracket before the next item
+bool JsonReader::next_item(char close) {
+    if (error) return false;
+    if (consume(close)) {
+        if (depth > 0) --depth;
+        return false;
+    }
+    if (!first[depth] && !consume(',')) return fail();
+    first[depth] = false;
+    return true;
+}
+
+bool JsonReader::next_member(JsonString& name) {
+    if (!next_item('}')) return false;
+    return (read_string(name) && consume(':')) || fail();
+}
+
+bool JsonReader::next_element() {
+    return next_item(']');
+}
+
+bool JsonReader::read_string(JsonString& out) {
+    if (!consume('"')) return fail();
+    size_t start = pos;
+    out.escaped = false;
+    for (;;) {
+        pos = find_string_special(doc, pos);
+        if (pos >= doc.size()) return fail();
+        char c = doc[pos];
+        if (c == '"') break;
+        if (c != '\\') return fail(); // raw control character
+
+        // validate the escape here so str() cannot fail later
+        out.escaped = true;
+        if (pos + 1 >= doc.size()) return fail();
+        char e = doc[pos + 1];
+        if (e == 'u') {
+            unsigned cp;
+            if (!read_hex4(doc, pos + 2, cp)) return fail();
+            pos += 6;
+            if (cp >= 0xdc00 && cp <= 0xdfff) return fail(); // lone low surrogate
+            if (cp >= 0xd800 && cp <= 0xdbff) {
+                unsigned low;
+                if (pos + 2 > doc.size() || doc[pos] != '\\' || doc[pos + 1] != 'u'
+                    || !read_hex4(doc, pos + 2, low) || low < 0xdc00 || low > 0xdfff) {
+                    return fail();
+                }
+                pos += 6;
+            }
+        } else if (e == '"' || e == '\\' || e == '/' || e == 'b' || e == 'f' || e == 'n' || e == 'r' || e == 't') {
+            pos += 2;
+        } else {
+            return fail();
+        }
+    }
+    out.raw = doc.substr(start, pos - start);
+    ++pos; // closing quote
+    return true;
+}
+
+bool JsonReader::skip_value() {
+    char c = peek();
+    if (c == '"') {
+        JsonString ignored;
+        return read_string(ignored);
+    }
+    if (c == '{') {
+        if (!open('{')) return false;
+        JsonString name;
+        while (next_item('}')) {
+            if (!read_string(name) || !consume(':') || !skip_value()) return fail();
+        }
+        return !error;
+    }
+    if (c == '[') {
+        if (!open('[')) return false;
+        while (next_item(']')) {
+            if (!skip_value()) return fail();
+        }
+        return !error;
+    }
+    if (c == 't') return skip_literal("true");
+    if (c == 'f') return skip_literal("false");
+    if (c == 'n') return skip_literal("null");
+    return skip_number();
+}
+
+bool JsonReader::skip_literal(std::string_view literal) {
+    if (doc.compare(pos, literal.size(), literal) != 0) return fail();
+    pos += literal.size();
+    return true;
+}
+
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+bool JsonReader::skip_number() {
+    auto digits = [this] {
+        size_t start = pos;
+        while (pos < doc.size() && doc[pos] >= '0' && doc[pos] <= '9') ++pos;
+        return pos > start;
+    };
+    if (pos < doc.size() && doc[pos] == '-') ++pos;
+    if (pos < doc.size() && doc[pos] == '0') {
+        ++pos;
+    } else if (!digits()) {
+        return fail();
+    }
+    if (pos < doc.size() && doc[pos] == '.') {
+        ++pos;
+        if (!digits()) return fail();
+    }
+    if (pos < doc.size() && (doc[pos] == 'e' || doc[pos] == 'E')) {
+        ++pos;
+        if (pos < doc.size() && (doc[pos] == '+' || doc[pos] == '-')) ++pos;
+        if (!digits()) return fail();
+    }
+    return true;
+}
+
+bool JsonReader::at_end() {
+    return !error && peek() == 0 && pos == doc.size();
+}
+
+// --- writing ---
+
+bool json_valid_utf8(std::string_view s) {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(s.data());
+    size_t size = s.size();
+    size_t pos = 0;
+    while (pos < size) {
+#if defined(__SSE2__)
+        // ASCII 16 bytes at a time, up to the first byte with the high bit set
+        for (; pos + 16 <= size; pos += 16) {
+            int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)));
+            if (mask != 0) {
+                pos += __builtin_ctz(mask);
+                break;
+            }
+        }
+        if (pos >= size) break;
+#endif
+        unsigned char c = data[pos];
+        if (c < 0x80) {
+            ++pos;
+            continue;
+        }
+        size_t len;
+        unsigned cp;
+        unsigned min; // smallest code point of this length, anything below is an overlong form
+        if ((c & 0xe0) == 0xc0) {
+            len = 2, cp = c & 0x1f, min = 0x80;
+        } else if ((c & 0xf0) == 0xe0) {
+            len = 3, cp = c & 0x0f, min = 0x800;
+        } else if ((c & 0xf8) == 0xf0) {
+            len = 4, cp = c & 0x07, min = 0x10000;
+        } else {
+            return false; // continuation byte or 0xf8-0xff
+        }
+        if (pos + len > size) return false;
+        for (size_t i = 1; i < len; ++i) {
+            if ((data[pos + i] & 0xc0) != 0x80) return false;
+            cp = (cp << 6) | (data[pos + i] & 0x3f);
+        }
+        if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) return false;
+        pos += len;
+    }
+    return true;
+}
+
+// escape sequence for a byte find_string_special stopped at
+static size_t escape_size(unsigned char c) {
+    switch (c) {
+        case '"': case '\\': case '\b': case '\f': case '\n': case '\r': case '\t':
+            return 2;
+        default:
+            return 6; // \u00XX
+    }
+}
+
+size_t json_escaped_size(std::string_view s) {
+    size_t size = s.size();
+    for (size_t pos = find_string_special(s, 0); pos < s.size(); pos = find_string_special(s, pos + 1)) {
+        size += escape_size(s[pos]) - 1;
+    }
+    return size;
+}
+
+char* json_write_escaped(char* out, std::string_view s) {
+    static const char hex[] = "0123456789abcdef";
+    size_t pos = 0;
+    for (;;) {
+        size_t special = find_string_special(s, pos);
+        std::memcpy(out, s.data() + pos, special - pos);
+        out += special - pos;
+        if (special == s.size()) return out;
+
+        unsigned char c = s[special];
+        *out++ = '\\';
+        switch (c) {
+            case '"': *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '\b': *out++ = 'b'; break;
+            case '\f': *out++ = 'f'; break;
+            case '\n': *out++ = 'n'; break;
+            case '\r': *out++ = 'r'; break;
+            case '\t': *out++ = 't'; break;
+            default:
+                *out++ = 'u';
+                *out++ = '0';
+                *out++ = '0';
+                *out++ = hex[c >> 4];
+                *out++ = hex[c & 0xf];
+        }
+        pos = special + 1;
+    }
+}
+
+void json_append_escaped(std::string& out, std::string_view s) {
+    size_t old_size = out.size();
+    out.resize(old_size + json_escaped_size(s));
+    json_write_escaped(&out[old_size], s);
+}
+
+size_t json_object_size(std::initializer_list<JsonField> fields) {
+    size_t size = 2; // {}
+    for (const JsonField& field : fields) {
+        size += json_escaped_size(field.name) + 3; // "":
+        size += field.raw ? field.value.size() : json_escaped_size(field.value) + 2;
+    }
+    return size + (fields.size() > 0 ? fields.size() - 1 : 0); // commas
+}
+
+char* json_write_object(char* out, std::initializer_list<JsonField> fields) {
+    *out++ = '{';
+    bool first = true;
+    for (const JsonField& field : fields) {
+        if (!first) *out++ = ',';
+        first = false;
+        *out++ = '"';
+        out = json_write_escaped(out, field.name);
+        *out++ = '"';
+        *out++ = ':';
+        if (field.raw) {
+            std::memcpy(out, field.value.data(), field.value.size());
+            out += field.value.size();
+        } else {
+            *out++ = '"';
+            out = json_write_escaped(out, field.value);
+            *out++ = '"';
+        }
+    }
+    *out++ = '}';
+    return out;
+}
+
+std::string json_object(std::initializer_list<JsonField> fields) {
+    std::string out(json_object_size(fields), '\0');
+    json_write_object(&out[0], fields);
+    return out;
+}
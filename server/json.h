@@ -0,0 +1,96 @@
+#ifndef SERVER_JSON_H
+#define SERVER_JSON_H
+
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+// Pull parser for JSON request bodies. Nothing is allocated while parsing:
+// strings come back as views of the raw text between the quotes and are
+// only decoded (json_unescape) when they actually contain escapes. String
+// contents, the bulk of a large value, are scanned 16 bytes at a time
+// with SSE2 where available.
+//
+// Any syntax error makes the reader fail for good; check failed() or the
+// return values, and at_end() once the document is consumed.
+
+struct JsonString {
+    std::string_view raw; // between the quotes, escapes not decoded
+    bool escaped = false; // raw contains at least one backslash escape
+
+    // decoded value, raw is copied as is when there is nothing to decode
+    std::string str() const;
+    // compares the decoded value with s
+    bool equals(std::string_view s) const;
+};
+
+class JsonReader {
+public:
+    // containers open at once, the ones the caller opened included
+    static const int MAX_DEPTH = 64;
+
+    explicit JsonReader(std::string_view doc) : doc(doc) {}
+
+    // '{' ... '}': call next_member until it returns false, then check failed()
+    bool begin_object();
+    bool next_member(JsonString& name);
+
+    // '[' ... ']': call next_element until it returns false, then check failed()
+    bool begin_array();
+    bool next_element();
+
+    bool read_string(JsonString& out);
+    // skips one value of any type, validating it
+    bool skip_value();
+
+    // true once only whitespace is left and nothing failed
+    bool at_end();
+    bool failed() const { return error; }
+
+private:
+    std::string_view doc;
+    size_t pos = 0;
+    bool error = false;
+    int depth = 0;                  // containers open
+    bool first[MAX_DEPTH + 1] = {}; // per depth: no comma before the next item yet
+
+    bool fail();
+    char peek();        // next non-whitespace character, 0 at the end
+    bool consume(char c);
+    bool open(char c);
+    bool next_item(char close);
+    bool skip_number();
+    bool skip_literal(std::string_view literal);
+};
+
+// decodes the escapes of a JSON string body (\uXXXX to UTF-8); false if one is malformed
+bool json_unescape(std::string_view raw, std::string& out);
+
+// Response side: strings are escaped with the same vectorized scan, and
+// documents are measured first so they are written into one buffer of
+// exactly the right size (a std::string or a cache buffer).
+
+// one member of a flat object; value is escaped and quoted unless raw (numbers, nested JSON)
+struct JsonField {
+    std::string_view name;
+    std::string_view value;
+    bool raw = false;
+};
+
+// true if s is well-formed UTF-8. The writers below escape only what JSON
+// requires, so a string that fails this would make the document invalid
+bool json_valid_utf8(std::string_view s);
+
+// length of s once escaped, without the quotes
+size_t json_escaped_size(std::string_view s);
+// writes s escaped (no quotes) at out and returns the end
+char* json_write_escaped(char* out, std::string_view s);
+void json_append_escaped(std::string& out, std::string_view s);
+
+size_t json_object_size(std::initializer_list<JsonField> fields);
+// writes {"name":"value",...} at out and returns the end
+char* json_write_object(char* out, std::initializer_list<JsonField> fields);
+std::string json_object(std::initializer_list<JsonField> fields);
+
+#endif
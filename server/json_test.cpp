@@ -0,0 +1,84 @@
+// Parser checks for JsonReader, run with `make test`.
+
+#include "json.h"
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, std::string_view doc) {
+    if (ok) return;
+    ++failures;
+    std::fprintf(stderr, "FAIL %s: %.*s\n", what, static_cast<int>(doc.size()), doc.data());
+}
+
+// skips one value and expects nothing after it
+static bool skips(std::string_view doc) {
+    JsonReader reader(doc);
+    return reader.skip_value() && reader.at_end();
+}
+
+// {"keys":[...],...} the way /mget reads it: the keys in order, other members skipped
+static bool read_keys(std::string_view doc, std::string& keys) {
+    JsonReader reader(doc);
+    keys.clear();
+    if (!reader.begin_object()) return false;
+    JsonString name;
+    while (reader.next_member(name)) {
+        if (!name.equals("keys")) {
+            if (!reader.skip_value()) return false;
+            continue;
+        }
+        if (!reader.begin_array()) return false;
+        JsonString key;
+        while (reader.next_element()) {
+            if (!reader.read_string(key)) return false;
+            keys += key.str();
+            keys += ';';
+        }
+    }
+    return reader.at_end();
+}
+
+int main() {
+    const char* valid[] = {
+        "{}", "[]", "[[]]", "[{}]", "{\"a\":{}}", "{\"a\":[]}", "[[],[]]", "[{},{}]",
+        "{\"a\":[],\"b\":{}}", "[1,[2,[3,[]]],{\"x\":[{}]}]", " { \"a\" : [ ] , \"b\" : 1 } ",
+    };
+    for (const char* doc : valid) check(skips(doc), "skip valid", doc);
+
+    const char* invalid[] = {
+        "{", "[", "[}", "{]", "[,]", "[1,]", "[1 2]", "{\"a\":[] \"b\":1}", "[[] []]",
+        "[{} {}]", "{\"a\":{},}", "[[],,[]]",
+    };
+    for (const char* doc : invalid) check(!skips(doc), "skip invalid", doc);
+
+    std::string deep(JsonReader::MAX_DEPTH, '[');
+    deep += std::string(JsonReader::MAX_DEPTH, ']');
+    check(skips(deep), "depth limit", "MAX_DEPTH arrays");
+    std::string too_deep = "[" + deep + "]";
+    check(!skips(too_deep), "depth limit", "MAX_DEPTH + 1 arrays");
+
+    std::string keys;
+    check(read_keys("{\"keys\":[],\"x\":1}", keys) && keys.empty(), "empty keys then member", "{\"keys\":[],\"x\":1}");
+    check(!read_keys("{\"keys\":[] \"x\":1}", keys), "missing comma after keys", "{\"keys\":[] \"x\":1}");
+    check(read_keys("{\"x\":[[],{}],\"keys\":[\"a\",\"b\"],\"y\":{}}", keys) && keys == "a;b;",
+          "keys between nested members", "{\"x\":[[],{}],\"keys\":[\"a\",\"b\"],\"y\":{}}");
+    check(!read_keys("{\"keys\":[\"a\" \"b\"]}", keys), "missing comma between keys", "{\"keys\":[\"a\" \"b\"]}");
+
+    const std::string_view utf8[] = {
+        "", "plain ascii, longer than sixteen bytes", "caf\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+        "0123456789abcdef\xc3\xa9 after a full ascii block",
+    };
+    for (std::string_view s : utf8) check(json_valid_utf8(s), "valid utf-8", s);
+    const std::string_view not_utf8[] = {
+        "\xff", "\x80", "caf\xc3", "\xc0\xaf", "\xe0\x80\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80",
+        "0123456789abcdef0123456789abcdef\xfe",
+    };
+    for (std::string_view s : not_utf8) check(!json_valid_utf8(s), "invalid utf-8", s);
+
+    if (failures == 0) std::printf("json_test: ok\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,813 @@
+#include "kv_service.h"
+#include "access_log.h"
+#include "config.h"
+#include "cache.h"
+#include "database.h"
+#include "db_guard.h"
+#include "json.h"
+#include "logger.h"
+#include "metrics.h"
+#include "profiled_mutex.h"
+#include "refresher.h"
+#include "router.h"
+#include "slab.h"
+#include "slow_log.h"
+
+#include <charconv>
+#include <cstring>
+#include <strings.h>
+
+// {"value":"..."}, other members are ignored; empty if the body is not such an object
+static std::string extract_value_from_json(const std::string& json_body) {
+    JsonReader reader(json_body);
+    JsonString name, value;
+    bool found = false;
+    if (!reader.begin_object()) return "";
+    while (reader.next_member(name)) {
+        if (name.equals("value")) {
+            if (!reader.read_string(value)) return "";
+            found = true;
+        } else if (!reader.skip_value()) {
+            return "";
+        }
+    }
+    if (!found || !reader.at_end()) return "";
+    return value.str();
+}
+
+// {"keys":["k1","k2",...]}
+static bool extract_keys_from_json(const std::string& json_body, std::vector<std::string>& keys) {
+    JsonReader reader(json_body);
+    JsonString name, key;
+    bool found = false;
+    if (!reader.begin_object()) return false;
+    while (reader.next_member(name)) {
+        if (!name.equals("keys")) {
+            if (!reader.skip_value()) return false;
+            continue;
+        }
+        found = true;
+        keys.clear();
+        if (!reader.begin_array()) return false;
+        while (reader.next_element()) {
+            if (!reader.read_string(key)) return false;
+            keys.push_back(key.str());
+        }
+    }
+    return found && reader.at_end();
+}
+
+// {"k1":"v1","k2":"v2",...}
+static bool extract_pairs_from_json(const std::string& json_body, std::vector<std::pair<std::string, std::string>>& items) {
+    JsonReader reader(json_body);
+    JsonString key, value;
+    if (!reader.begin_object()) return false;
+    while (reader.next_member(key)) {
+        if (!reader.read_string(value)) return false;
+        items.emplace_back(key.str(), value.str());
+    }
+    return reader.at_end();
+}
+
+// "application/octet-stream; charset=x" -> true for type, case-insensitive
+static bool media_type_is(std::string_view value, std::string_view type) {
+    value = value.substr(0, value.find(';'));
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+    return value.size() == type.size() && strncasecmp(value.data(), type.data(), type.size()) == 0;
+}
+
+KvFormats kv_negotiate(std::string_view content_type, std::string_view accept) {
+    KvFormats formats;
+    if (media_type_is(content_type, "application/octet-stream")) formats.body = KvFormat::RAW;
+
+    // the first acceptable type in the list decides, entries with q=0 are refused types
+    while (!accept.empty()) {
+        size_t comma = accept.find(',');
+        std::string_view entry = accept.substr(0, comma);
+        accept = comma == std::string_view::npos ? std::string_view() : accept.substr(comma + 1);
+        size_t q = entry.find("q=0");
+        if (q != std::string_view::npos && entry.find_first_not_of("0.", q + 2) >= entry.size()) continue;
+        if (media_type_is(entry, "application/octet-stream")) {
+            formats.response = KvFormat::RAW;
+            break;
+        }
+        if (media_type_is(entry, "application/json") || media_type_is(entry, "application/*") || media_type_is(entry, "*/*")) {
+            break;
+        }
+    }
+    return formats;
+}
+
+// raw GET response: the stored bytes as the body, shared with the cache when they come from it
+static void set_raw_value(KvResponse& res, std::string_view key, const char* source) {
+    res.content_type = "application/octet-stream";
+    res.headers.emplace_back("X-Key", std::string(key));
+    res.headers.emplace_back("X-Source", source);
+}
+
+// 406 for a value JSON cannot carry: stored raw, it need not be UTF-8
+static void reject_not_utf8(KvResponse& res) {
+    res.status = 406;
+    res.body = "{\"error\":\"Value is not valid UTF-8, fetch it with Accept: application/octet-stream\"}";
+}
+
+// 503 response used when db_guard sheds a call
+static void reject_db_unavailable(KvResponse& res) {
+    res.status = 503;
+    res.source = AccessSource::NONE; // the call never reached the database
+    res.headers.emplace_back("Retry-After", "1");
+    res.body = "{\"error\":\"Database unavailable\"}";
+}
+
+void kv_service_init() {
+    // Initialize Database Connection Pool
+    // We create as many DB connections as there are worker threads to minimize waiting
+    LOG_INFO("Initializing MySQL connection pool with " + std::to_string(DB_POOL_SIZE) + " connections...");
+    db_init(DB_POOL_SIZE);
+
+    if (!ACCESS_LOG_PATH.empty()) {
+        access_log_open(ACCESS_LOG_PATH);
+    }
+
+    metrics_register("kv_cache_entries", "Keys currently cached.", [] {
+        std::lock_guard<ProfiledMutex> lock(cache_mutex);
+        return static_cast<double>(lru_list.size());
+    });
+    metrics_register("kv_db_concurrency_limit", "Concurrent database calls currently admitted by db_guard.", [] { return db_guard_limit(); });
+    metrics_register("kv_db_breaker_open", "1 while the database circuit breaker is open.", [] { return db_guard_is_open() ? 1.0 : 0.0; });
+    metrics_register("kv_log_dropped_total", "Log lines dropped because the log ring was full.",
+                     [] { return static_cast<double>(log_dropped_count()); }, MetricType::COUNTER);
+    metrics_register("kv_lock_profiling_enabled", "1 while lock profiling is switched on.",
+                     [] { return lock_profiling.load(std::memory_order_relaxed) ? 1.0 : 0.0; });
+    metrics_register("kv_access_log_dropped_total", "Binary access log records dropped.",
+                     [] { return static_cast<double>(access_log_dropped()); }, MetricType::COUNTER);
+
+    if (CACHE_SOFT_TTL_MS > 0) {
+        LOG_INFO("Cache soft expiry enabled (" + std::to_string(CACHE_SOFT_TTL_MS) + " ms), stale entries are refreshed in the background");
+        refresher_init();
+    }
+}
+
+// GET /kv/{key}, cache stage
+bool kv_get_cached(std::string_view key, const std::string& client, KvResponse& res, KvFormat format) {
+    CacheHit hit;
+    bool needs_refresh = false;
+    bool found;
+    uint64_t cache_start = stage_now();
+    {
+        std::lock_guard<ProfiledMutex> lock(cache_mutex);
+        found = cache_lookup(key, hit, &needs_refresh); // checking in cache
+    }
+    metrics_stage_since(MetricStage::CACHE, cache_start);
+    if (!found) return false;
+    if (needs_refresh) {
+        refresher_schedule(std::string(key)); // serve the stale value now, refresh off the request path
+    }
+
+    if (format == KvFormat::RAW) {
+        set_raw_value(res, key, "cache");
+        res.shared_body = std::move(hit.value);
+    } else if (!hit.response && !json_valid_utf8(std::string_view(hit.value->data(), hit.value->size()))) {
+        reject_not_utf8(res);
+        res.source = AccessSource::CACHE;
+        LOG_ACCESS(log_request_prefix("GET /kv/", key, client) + " -> Status: 406, Source: cache (not UTF-8)");
+        return true;
+    } else if (!hit.response) {
+        // first hit since the value changed, serialize once and share it with later hits
+        uint64_t serialize_start = stage_now();
+        std::initializer_list<JsonField> fields = {
+            {"key", key}, {"value", std::string_view(hit.value->data(), hit.value->size())}, {"source", "cache"}};
+        hit.response = make_shared_buffer(json_object_size(fields), [&](char* out) { json_write_object(out, fields); });
+        metrics_stage_since(MetricStage::SERIALIZE, serialize_start);
+        std::lock_guard<ProfiledMutex> lock(cache_mutex);
+        cache_store_response(key, hit.version, hit.response);
+    }
+    res.status = 200;
+    res.source = AccessSource::CACHE;
+    if (format == KvFormat::JSON) res.shared_body = std::move(hit.response);
+    LOG_ACCESS(log_request_prefix("GET /kv/", key, client) + " -> Status: 200, Source: cache");
+    return true;
+}
+
+// GET /kv/{key}
+KvResponse kv_get(const std::string& key, const std::string& client, KvFormat format, bool cache_checked) {
+    KvResponse res;
+    if (!cache_checked && kv_get_cached(key, client, res, format)) { // found in cache
+        return res;
+    }
+
+    auto log_msg_prefix = [&] { return log_request_prefix("GET /kv/", key, client); }; // only built for logged requests
+    std::string source_str;
+
+    // cache miss, goto database
+    metrics_count(MetricCounter::CACHE_MISSES);
+    res.source = AccessSource::DATABASE;
+    std::string value = db_read(key);
+    if (!value.empty()) { // found in database
+        res.status = 200;
+        source_str = "database (cache miss)";
+        SharedBuffer cached = make_shared_buffer(value);
+        if (format == KvFormat::RAW) {
+            set_raw_value(res, key, "database");
+            res.shared_body = cached;
+        } else if (!json_valid_utf8(value)) {
+            reject_not_utf8(res);
+            source_str = "database (not UTF-8)";
+        } else {
+            uint64_t serialize_start = stage_now();
+            res.body = json_object({{"key", key}, {"value", value}, {"source", "database"}});
+            metrics_stage_since(MetricStage::SERIALIZE, serialize_start);
+        }
+        {
+            std::lock_guard<ProfiledMutex> lock(cache_mutex); 
+            cache_put(key, std::move(cached)); // update cache
+        }
+    } else if (db_call_rejected()) { // database unhealthy or saturated, fail fast
+        reject_db_unavailable(res);
+        source_str = "rejected (database unavailable)";
+    } else { //not found in database
+        res.status = 404;
+        source_str = "not found";
+        res.body = "{\"error\":\"Key not found\"}";
+    }
+    if (res.status == 503) {
+        LOG_WARN(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Source: " + source_str);
+    } else {
+        LOG_ACCESS(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Source: " + source_str);
+    }
+    return res;
+}
+
+// POST /kv/{key}
+KvResponse kv_create(const std::string& key, const std::string& body, const std::string& client, KvFormat format) {
+    KvResponse res;
+    auto log_msg_prefix = [&] { return log_request_prefix("POST /kv/", key, client); };
+
+    std::string value_from_body = format == KvFormat::RAW ? body : extract_value_from_json(body);
+    if (value_from_body.empty()) {
+        res.status = 400;
+        res.body = format == KvFormat::RAW ? "{\"error\":\"Empty request body\"}"
+                                           : "{\"error\":\"Missing value in request body or invalid JSON format\"}";
+        LOG_ACCESS(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Bad Request (missing value)");
+        return res;
+    }
+
+    res.source = AccessSource::DATABASE;
+    if (db_create(key, value_from_body)) {
+        res.status = 201; 
+        res.body = "{\"message\":\"Key-value pair created\"}";
+        {
+            //std::lock_guard<ProfiledMutex> lock(cache_mutex);
+            //cache_put(key, value_from_body); 
+        }
+        LOG_ACCESS(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Action: Created (DB+Cache)");
+    } else if (db_call_rejected()) {
+        reject_db_unavailable(res);
+        LOG_WARN(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Database unavailable");
+    } else {
+        bool exists = db_key_exists(key); // guarded too, may be shed like the call above
+        if (db_call_rejected()) {
+            reject_db_unavailable(res);
+            LOG_WARN(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Database unavailable");
+        } else if (exists) {
+            res.status = 409;
+            res.body = "{\"error\":\"Key already exists. Use PUT to update.\"}";
+            LOG_ACCESS(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Conflict (Key exists)");
+        } else {
+            res.status = 500;
+            res.body = "{\"error\":\"Failed to store in database\"}";
+            LOG_ERROR(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: DB write failed");
+        }
+    }
+    return res;
+}
+
+// PUT /kv/{key}
+KvResponse kv_update(const std::string& key, const std::string& body, const std::string& client, KvFormat format) {
+    KvResponse res;
+    auto log_msg_prefix = [&] { return log_request_prefix("PUT /kv/", key, client); };
+
+    std::string value_from_body = format == KvFormat::RAW ? body : extract_value_from_json(body);
+    if (value_from_body.empty()) {
+        res.status = 400;
+        res.body = format == KvFormat::RAW ? "{\"error\":\"Empty request body\"}"
+                                           : "{\"error\":\"Missing value in request body or invalid JSON format\"}";
+        LOG_ACCESS(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Bad Request (missing value)");
+        return res;
+    }
+
+    res.source = AccessSource::DATABASE;
+    if (db_update(key, value_from_body)) {
+        res.status = 200;
+        res.body = "{\"message\":\"Key-value pair updated\"}";
+        SharedBuffer cached = make_shared_buffer(value_from_body);
+        {
+            std::lock_guard<ProfiledMutex> lock(cache_mutex);
+            cache_put(key, std::move(cached));
+        }
+        LOG_ACCESS(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Action: Updated (DB+Cache)");
+    } else if (db_call_rejected()) {
+        reject_db_unavailable(res);
+        LOG_WARN(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Database unavailable");
+    } else {
+        bool exists = db_key_exists(key);
+        if (db_call_rejected()) {
+            reject_db_unavailable(res);
+            LOG_WARN(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Database unavailable");
+        } else if (!exists) {
+            res.status = 404; 
+            res.body = "{\"error\":\"Key not found. Use POST to create.\"}";
+            LOG_ACCESS(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Not Found (Key missing)");
+        } else {
+            res.status = 500;
+            res.body = "{\"error\":\"Failed to update in database\"}";
+            LOG_ERROR(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: DB update failed");
+        }
+    }
+    return res;
+}
+
+// DELETE /kv/{key}
+KvResponse kv_delete(const std::string& key, const std::string& client) {
+    KvResponse res;
+    auto log_msg_prefix = [&] { return log_request_prefix("DELETE /kv/", key, client); };
+
+    res.source = AccessSource::DATABASE;
+    if (db_delete(key)) {
+        res.status = 200;
+        res.body = "{\"message\":\"Key-value pair deleted\"}";
+        {
+            std::lock_guard<ProfiledMutex> lock(cache_mutex);
+            cache_delete(key); 
+        }
+        LOG_ACCESS(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Action: Deleted (DB+Cache)");
+    } else if (db_call_rejected()) {
+        reject_db_unavailable(res);
+        LOG_WARN(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Database unavailable");
+    } else {
+        bool exists = db_key_exists(key);
+        if (db_call_rejected()) {
+            reject_db_unavailable(res);
+            LOG_WARN(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Database unavailable");
+        } else if (!exists) {
+             res.status = 200;
+             res.body = "{\"error\":\"Key not found\"}";
+             LOG_ACCESS(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Not Found (Key missing)");
+        } else {
+            res.status = 500;
+            res.body = "{\"error\":\"Failed to delete key from database\"}";
+            LOG_ERROR(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: DB delete failed");
+        }
+    }
+    return res;
+}
+
+// POST /mget
+KvResponse kv_mget(const std::string& json_body, const std::string& client) {
+    KvResponse res;
+    auto log_msg_prefix = [&] { return log_request_prefix("POST /mget", {}, client); };
+
+    std::vector<std::string> keys;
+    if (!extract_keys_from_json(json_body, keys) || keys.empty() || keys.size() > BATCH_MAX_KEYS) {
+        res.status = 400;
+        res.body = "{\"error\":\"Expected a keys array of 1 to " + std::to_string(BATCH_MAX_KEYS) + " keys\"}";
+        LOG_ACCESS(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Bad Request (keys)");
+        return res;
+    }
+
+    std::vector<SharedBuffer> values;
+    KvStatus status = kv_values_get(keys, values);
+    if (status == KvStatus::UNAVAILABLE) {
+        reject_db_unavailable(res);
+        LOG_WARN(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Database unavailable");
+        return res;
+    }
+    if (status == KvStatus::FAILED) {
+        res.status = 500;
+        res.body = "{\"error\":\"Failed to read from database\"}";
+        LOG_ERROR(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: DB read failed");
+        return res;
+    }
+
+    // {"values":{"k":"v",...},"missing":["k",...]}, measured first and written into one buffer.
+    // Values JSON cannot carry are listed under "not_utf8" instead, to be fetched raw one by one
+    enum class Entry : char { MISSING, FOUND, NOT_UTF8 };
+    uint64_t serialize_start = stage_now();
+    std::vector<Entry> entries(keys.size(), Entry::MISSING);
+    size_t found = 0;
+    size_t not_utf8 = 0;
+    size_t size = std::strlen("{\"values\":{},\"missing\":[],\"not_utf8\":[]}");
+    for (size_t i = 0; i < keys.size(); ++i) {
+        size += json_escaped_size(keys[i]) + 3; // quotes + separator
+        if (!values[i]) continue;
+        std::string_view value(values[i]->data(), values[i]->size());
+        if (!json_valid_utf8(value)) {
+            entries[i] = Entry::NOT_UTF8;
+            ++not_utf8;
+            continue;
+        }
+        entries[i] = Entry::FOUND;
+        ++found;
+        size += json_escaped_size(value) + 3; // :""
+    }
+    std::string body;
+    body.reserve(size);
+    auto append_keys = [&](Entry entry) {
+        for (size_t i = 0, n = 0; i < keys.size(); ++i) {
+            if (entries[i] != entry) continue;
+            if (n++ > 0) body += ',';
+            body += '"';
+            json_append_escaped(body, keys[i]);
+            body += '"';
+        }
+    };
+    body += "{\"values\":{";
+    for (size_t i = 0, n = 0; i < keys.size(); ++i) {
+        if (entries[i] != Entry::FOUND) continue;
+        if (n++ > 0) body += ',';
+        body += '"';
+        json_append_escaped(body, keys[i]);
+        body += "\":\"";
+        json_append_escaped(body, std::string_view(values[i]->data(), values[i]->size()));
+        body += '"';
+    }
+    body += "},\"missing\":[";
+    append_keys(Entry::MISSING);
+    if (not_utf8 > 0) {
+        body += "],\"not_utf8\":[";
+        append_keys(Entry::NOT_UTF8);
+    }
+    body += "]}";
+    metrics_stage_since(MetricStage::SERIALIZE, serialize_start);
+    res.status = 200;
+    res.body = std::move(body);
+    LOG_ACCESS(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Keys: " + std::to_string(keys.size())
+                + ", Found: " + std::to_string(found) + (not_utf8 > 0 ? ", Not UTF-8: " + std::to_string(not_utf8) : ""));
+    return res;
+}
+
+// POST /mset
+KvResponse kv_mset(const std::string& json_body, const std::string& client) {
+    KvResponse res;
+    auto log_msg_prefix = [&] { return log_request_prefix("POST /mset", {}, client); };
+
+    std::vector<std::pair<std::string, std::string>> items;
+    bool valid = extract_pairs_from_json(json_body, items) && !items.empty() && items.size() <= BATCH_MAX_KEYS;
+    for (size_t i = 0; valid && i < items.size(); ++i) {
+        valid = !items[i].first.empty() && !items[i].second.empty();
+    }
+    if (!valid) {
+        res.status = 400;
+        res.body = "{\"error\":\"Expected a JSON object of 1 to " + std::to_string(BATCH_MAX_KEYS) + " non-empty key/value strings\"}";
+        LOG_ACCESS(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Bad Request (pairs)");
+        return res;
+    }
+
+    res.source = AccessSource::DATABASE;
+    KvStatus status = kv_values_set(items);
+    if (status == KvStatus::OK) {
+        res.status = 200;
+        res.body = "{\"message\":\"Key-value pairs stored\",\"count\":" + std::to_string(items.size()) + "}";
+        LOG_ACCESS(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Action: Stored " + std::to_string(items.size()) + " (DB+Cache)");
+    } else if (status == KvStatus::UNAVAILABLE) {
+        reject_db_unavailable(res);
+        LOG_WARN(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: Database unavailable");
+    } else {
+        res.status = 500;
+        res.body = "{\"error\":\"Failed to store in database\"}";
+        LOG_ERROR(log_msg_prefix() + " -> Status: " + std::to_string(res.status) + ", Error: DB write failed");
+    }
+    return res;
+}
+
+// GET /stats/slabs - per size class usage of the cache's slab allocator
+KvResponse kv_slab_stats() {
+    KvResponse res;
+    std::string body = "{\"classes\":[";
+    bool first = true;
+    for (const SlabClassStats& cls : slab_stats()) {
+        if (!first) body += ",";
+        first = false;
+        body += "{\"chunk_size\":" + std::to_string(cls.chunk_size)
+              + ",\"pages\":" + std::to_string(cls.pages)
+              + ",\"total_chunks\":" + std::to_string(cls.total_chunks)
+              + ",\"used_chunks\":" + std::to_string(cls.used_chunks)
+              + ",\"allocs\":" + std::to_string(cls.allocs)
+              + ",\"frees\":" + std::to_string(cls.frees) + "}";
+    }
+    body += "],\"large_allocs\":" + std::to_string(slab_large_allocs()) + "}";
+    res.status = 200;
+    res.body = body;
+    return res;
+}
+
+KvResponse kv_metrics() {
+    KvResponse res;
+    res.status = 200;
+    res.content_type = "text/plain; version=0.0.4";
+    res.body = metrics_render();
+
+    // slab usage per size class, labelled by chunk size
+    std::vector<SlabClassStats> classes = slab_stats();
+    auto per_class = [&](const char* name, const char* help, const char* type, auto field) {
+        res.body += std::string("# HELP ") + name + ' ' + help + "\n# TYPE " + name + ' ' + type + '\n';
+        for (const SlabClassStats& cls : classes) {
+            res.body += std::string(name) + "{chunk_size=\"" + std::to_string(cls.chunk_size) + "\"} "
+                      + std::to_string(field(cls)) + '\n';
+        }
+    };
+    per_class("kv_slab_pages", "Pages held by a slab class.", "gauge", [](const SlabClassStats& c) { return c.pages; });
+    per_class("kv_slab_chunks", "Chunks in a slab class.", "gauge", [](const SlabClassStats& c) { return c.total_chunks; });
+    per_class("kv_slab_used_chunks", "Chunks in use in a slab class.", "gauge", [](const SlabClassStats& c) { return c.used_chunks; });
+    per_class("kv_slab_allocs_total", "Allocations served by a slab class.", "counter", [](const SlabClassStats& c) { return c.allocs; });
+    per_class("kv_slab_frees_total", "Chunks returned to a slab class.", "counter", [](const SlabClassStats& c) { return c.frees; });
+    res.body += "# HELP kv_slab_large_allocs_total Allocations too large for any slab class.\n"
+                "# TYPE kv_slab_large_allocs_total counter\n"
+                "kv_slab_large_allocs_total " + std::to_string(slab_large_allocs()) + '\n';
+    return res;
+}
+
+KvResponse kv_lock_profiling(std::string_view state) {
+    KvResponse res;
+    if (state != "on" && state != "off") {
+        res.status = 400;
+        res.body = "{\"error\":\"Expected /admin/lock-profiling/on or /admin/lock-profiling/off\"}";
+        return res;
+    }
+    lock_profiling_set(state == "on");
+    LOG_INFO(std::string("Lock profiling switched ") + (state == "on" ? "on" : "off"));
+    res.status = 200;
+    res.body = std::string("{\"lock_profiling\":") + (state == "on" ? "true" : "false") + "}";
+    return res;
+}
+
+// {"interval_ms":N,"requests":[{"op","key","status","client","unix_ms","latency_us","stages_us":{...}},...]}
+KvResponse kv_slow_requests() {
+    KvResponse res;
+    std::string body = "{\"interval_ms\":" + std::to_string(SLOW_LOG_INTERVAL_MS) + ",\"requests\":[";
+    bool first = true;
+    for (const SlowRequest& slow : slow_log_snapshot()) {
+        std::string stages = "{";
+        for (size_t st = 0; st < static_cast<size_t>(MetricStage::COUNT); ++st) {
+            if (static_cast<MetricStage>(st) == MetricStage::WRITE) continue; // never traced
+            if (stages.size() > 1) stages += ",";
+            stages += std::string("\"") + metrics_stage_name(static_cast<MetricStage>(st)) + "\":"
+                    + std::to_string(slow.stages.ns[st] / 1000);
+        }
+        stages += "}";
+        std::string status = std::to_string(slow.status);
+        std::string unix_ms = std::to_string(slow.unix_ms);
+        std::string latency_us = std::to_string(slow.latency_ns / 1000);
+        if (!first) body += ",";
+        first = false;
+        body += json_object({{"op", access_op_name(slow.op)}, {"key", slow.key}, {"status", status, true},
+                             {"client", slow.client}, {"unix_ms", unix_ms, true}, {"latency_us", latency_us, true},
+                             {"stages_us", stages, true}});
+    }
+    body += "]}";
+    res.status = 200;
+    res.body = std::move(body);
+    return res;
+}
+
+KvResponse kv_log_level(std::string_view level) {
+    static const std::pair<std::string_view, LogLevel> LEVELS[] = {
+        {"debug", LogLevel::DEBUG}, {"info", LogLevel::INFO}, {"warn", LogLevel::WARN}, {"error", LogLevel::ERROR}};
+    KvResponse res;
+    for (const auto& entry : LEVELS) {
+        if (entry.first != level) continue;
+        // logged under the old threshold, so raising it still leaves a trace
+        LOG_WARN("Log level set to " + std::string(level));
+        log_set_level(entry.second);
+        res.status = 200;
+        res.body = "{\"log_level\":\"" + std::string(level) + "\"}";
+        return res;
+    }
+    res.status = 400;
+    res.body = "{\"error\":\"Expected /admin/log-level/debug, info, warn or error\"}";
+    return res;
+}
+
+KvResponse kv_access_sample(std::string_view every) {
+    KvResponse res;
+    uint32_t n = 0;
+    auto parsed = std::from_chars(every.data(), every.data() + every.size(), n);
+    if (parsed.ec != std::errc() || parsed.ptr != every.data() + every.size()) {
+        res.status = 400;
+        res.body = "{\"error\":\"Expected /admin/access-sample/{n}, one access line in every n requests (0 = none)\"}";
+        return res;
+    }
+    log_set_access_sample(n);
+    LOG_INFO("Access log sampling set to one in " + std::to_string(n));
+    res.status = 200;
+    res.body = "{\"access_sample_every\":" + std::to_string(n) + "}";
+    return res;
+}
+
+bool kv_value_cached(std::string_view key, SharedBuffer& value) {
+    CacheHit hit;
+    bool needs_refresh = false;
+    bool found;
+    uint64_t cache_start = stage_now();
+    {
+        std::lock_guard<ProfiledMutex> lock(cache_mutex);
+        found = cache_lookup(key, hit, &needs_refresh);
+    }
+    metrics_stage_since(MetricStage::CACHE, cache_start);
+    if (!found) return false;
+    if (needs_refresh) {
+        refresher_schedule(std::string(key));
+    }
+    value = std::move(hit.value);
+    return true;
+}
+
+KvStatus kv_value_load(const std::string& key, SharedBuffer& value) {
+    metrics_count(MetricCounter::CACHE_MISSES);
+    std::string stored = db_read(key);
+    if (!stored.empty()) {
+        value = make_shared_buffer(stored);
+        std::lock_guard<ProfiledMutex> lock(cache_mutex);
+        cache_put(key, value);
+        return KvStatus::OK;
+    }
+    return db_call_rejected() ? KvStatus::UNAVAILABLE : KvStatus::NOT_FOUND;
+}
+
+KvStatus kv_value_set(const std::string& key, const std::string& value) {
+    if (db_upsert(key, value)) {
+        SharedBuffer cached = make_shared_buffer(value);
+        std::lock_guard<ProfiledMutex> lock(cache_mutex);
+        cache_put(key, std::move(cached));
+        return KvStatus::OK;
+    }
+    return db_call_rejected() ? KvStatus::UNAVAILABLE : KvStatus::FAILED;
+}
+
+KvStatus kv_value_delete(const std::string& key) {
+    if (db_delete(key)) {
+        std::lock_guard<ProfiledMutex> lock(cache_mutex);
+        cache_delete(key);
+        return KvStatus::OK;
+    }
+    if (db_call_rejected()) return KvStatus::UNAVAILABLE;
+    bool exists = db_key_exists(key);
+    if (db_call_rejected()) return KvStatus::UNAVAILABLE;
+    return exists ? KvStatus::FAILED : KvStatus::NOT_FOUND;
+}
+
+KvStatus kv_values_get(const std::vector<std::string>& keys, std::vector<SharedBuffer>& values) {
+    values.assign(keys.size(), nullptr);
+    std::vector<std::string> refresh;
+    std::vector<std::string> misses;
+    uint64_t cache_start = stage_now();
+    {
+        // one lock acquisition for all keys
+        std::lock_guard<ProfiledMutex> lock(cache_mutex);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            bool needs_refresh = false;
+            values[i] = cache_get(keys[i], &needs_refresh);
+            if (needs_refresh) refresh.push_back(keys[i]);
+            if (!values[i]) misses.push_back(keys[i]);
+        }
+    }
+    metrics_stage_since(MetricStage::CACHE, cache_start);
+    for (const std::string& key : refresh) {
+        refresher_schedule(key);
+    }
+    if (misses.empty()) return KvStatus::OK;
+
+    // every miss in one query
+    std::unordered_map<std::string, std::string> found;
+    if (!db_read_many(misses, found)) {
+        return db_call_rejected() ? KvStatus::UNAVAILABLE : KvStatus::FAILED;
+    }
+    // buffers are built before taking the lock, as in kv_values_set
+    std::vector<size_t> loaded;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (values[i]) continue;
+        auto it = found.find(keys[i]);
+        if (it == found.end()) continue;
+        values[i] = make_shared_buffer(it->second);
+        loaded.push_back(i);
+    }
+    std::lock_guard<ProfiledMutex> lock(cache_mutex);
+    for (size_t i : loaded) {
+        cache_put(keys[i], values[i]);
+    }
+    return KvStatus::OK;
+}
+
+KvStatus kv_values_set(const std::vector<std::pair<std::string, std::string>>& items) {
+    if (!db_upsert_many(items)) {
+        return db_call_rejected() ? KvStatus::UNAVAILABLE : KvStatus::FAILED;
+    }
+    std::vector<SharedBuffer> cached;
+    cached.reserve(items.size());
+    for (const auto& item : items) {
+        cached.push_back(make_shared_buffer(item.second));
+    }
+    std::lock_guard<ProfiledMutex> lock(cache_mutex);
+    for (size_t i = 0; i < items.size(); ++i) {
+        cache_put(items[i].first, std::move(cached[i]));
+    }
+    return KvStatus::OK;
+}
+
+static AccessOp access_op(Route route) {
+    switch (route) {
+        case Route::KV_GET:     return AccessOp::GET;
+        case Route::KV_CREATE:  return AccessOp::CREATE;
+        case Route::KV_UPDATE:  return AccessOp::UPDATE;
+        case Route::KV_DELETE:  return AccessOp::DELETE;
+        case Route::KV_MGET:    return AccessOp::MGET;
+        case Route::KV_MSET:    return AccessOp::MSET;
+        case Route::SLAB_STATS: return AccessOp::STATS;
+        case Route::METRICS:    return AccessOp::METRICS;
+        case Route::LOCK_PROFILING: return AccessOp::ADMIN;
+        case Route::SLOW_REQUESTS:  return AccessOp::ADMIN;
+        case Route::LOG_LEVEL:      return AccessOp::ADMIN;
+        case Route::ACCESS_SAMPLE:  return AccessOp::ADMIN;
+        case Route::NOT_FOUND:  break;
+    }
+    return AccessOp::OTHER;
+}
+
+// request metrics, the slow request log, and the binary access log when enabled
+// start is a stage_now() reading
+static void record_request(const RouteMatch& match, const std::string& client, const KvResponse& res, uint64_t start) {
+    uint64_t latency_ns = stage_elapsed_ns(start);
+    AccessOp op = access_op(match.route);
+    metrics_request(op, res.status, latency_ns);
+    slow_log_offer(op, match.key, res.status, latency_ns, client, metrics_trace());
+    metrics_trace_reset();
+    if (access_log_enabled()) access_log_write(op, match.key, res.status, res.source, latency_ns, client);
+}
+
+bool kv_dispatch_cached(const std::string& method, const std::string& path, const std::string& client, KvResponse& res,
+                        KvFormat format) {
+    RouteMatch match = match_route(method, path);
+    uint64_t start = stage_now();
+    bool served = true;
+    if (match.route == Route::KV_GET) {
+        served = kv_get_cached(match.key, client, res, format);
+    } else if (match.route == Route::SLAB_STATS) {
+        res = kv_slab_stats();
+    } else if (match.route == Route::METRICS) {
+        res = kv_metrics();
+    } else if (match.route == Route::LOCK_PROFILING) {
+        res = kv_lock_profiling(match.key);
+    } else if (match.route == Route::SLOW_REQUESTS) {
+        res = kv_slow_requests();
+    } else if (match.route == Route::LOG_LEVEL) {
+        res = kv_log_level(match.key);
+    } else if (match.route == Route::ACCESS_SAMPLE) {
+        res = kv_access_sample(match.key);
+    } else {
+        served = false; // writes and misses need the database
+    }
+    if (served) {
+        record_request(match, client, res, start);
+    } else {
+        metrics_trace_reset(); // the executor traces the retry from scratch
+    }
+    return served;
+}
+
+static KvResponse run_route(const RouteMatch& match, const std::string& body, const std::string& client, KvFormats formats,
+                            bool cache_checked) {
+    switch (match.route) {
+        case Route::KV_GET:    return kv_get(std::string(match.key), client, formats.response, cache_checked);
+        case Route::KV_CREATE: return kv_create(std::string(match.key), body, client, formats.body);
+        case Route::KV_UPDATE: return kv_update(std::string(match.key), body, client, formats.body);
+        case Route::KV_DELETE: return kv_delete(std::string(match.key), client);
+        case Route::KV_MGET:   return kv_mget(body, client);
+        case Route::KV_MSET:   return kv_mset(body, client);
+        case Route::SLAB_STATS: return kv_slab_stats();
+        case Route::METRICS:    return kv_metrics();
+        case Route::LOCK_PROFILING: return kv_lock_profiling(match.key);
+        case Route::SLOW_REQUESTS:  return kv_slow_requests();
+        case Route::LOG_LEVEL:      return kv_log_level(match.key);
+        case Route::ACCESS_SAMPLE:  return kv_access_sample(match.key);
+        case Route::NOT_FOUND: break;
+    }
+
+    KvResponse res;
+    res.status = 404;
+    res.content_type.clear();
+    return res;
+}
+
+KvResponse kv_handle(const RouteMatch& match, const std::string& body, const std::string& client, KvFormats formats,
+                     bool cache_checked) {
+    uint64_t start = stage_now();
+    KvResponse res = run_route(match, body, client, formats, cache_checked);
+    record_request(match, client, res, start);
+    return res;
+}
+
+KvResponse kv_dispatch(const std::string& method, const std::string& path, const std::string& body, const std::string& client,
+                       KvFormats formats, bool cache_checked) {
+    return kv_handle(match_route(method, path), body, client, formats, cache_checked);
+}
@@ -0,0 +1,100 @@
+#ifndef SERVER_KV_SERVICE_H
+#define SERVER_KV_SERVICE_H
+
+#include "access_record.h"
+#include "cache.h"
+#include "router.h"
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Request handling for the key-value routes, independent of the network
+// front end. ServerApp (httplib) and EventServer (epoll) both translate
+// their requests into these calls, so every front end serves identical routes.
+
+struct KvResponse {
+    int status = 200;
+    std::string body;
+    // pre-serialized body shared with the cache; sent instead of body when set
+    SharedBuffer shared_body;
+    std::string content_type = "application/json";
+    std::vector<std::pair<std::string, std::string>> headers;
+    // where the answer came from, for the binary access log
+    AccessSource source = AccessSource::NONE;
+
+    std::string_view body_view() const {
+        if (shared_body) return std::string_view(shared_body->data(), shared_body->size());
+        return body;
+    }
+};
+
+// how a value travels in a body, negotiated per request: JSON ({"value":"..."} in,
+// {"key","value","source"} out) or RAW (application/octet-stream, the bytes as stored,
+// metadata in X-Key / X-Source headers). Error bodies are always JSON.
+enum class KvFormat { JSON, RAW };
+struct KvFormats {
+    KvFormat body = KvFormat::JSON;     // from Content-Type
+    KvFormat response = KvFormat::JSON; // from Accept
+};
+KvFormats kv_negotiate(std::string_view content_type, std::string_view accept);
+
+// connection pool, cache refresher
+void kv_service_init();
+
+// client is "addr:port" of the peer and only used for the access log
+// cache_checked: kv_get_cached already missed for this request, go straight to the database
+KvResponse kv_get(const std::string& key, const std::string& client, KvFormat format = KvFormat::JSON, bool cache_checked = false);
+// cache stage of kv_get: fills res and returns true on a hit, never touches the database
+bool kv_get_cached(std::string_view key, const std::string& client, KvResponse& res, KvFormat format = KvFormat::JSON);
+KvResponse kv_create(const std::string& key, const std::string& body, const std::string& client, KvFormat format = KvFormat::JSON);
+KvResponse kv_update(const std::string& key, const std::string& body, const std::string& client, KvFormat format = KvFormat::JSON);
+KvResponse kv_delete(const std::string& key, const std::string& client);
+// POST /mget {"keys":["k1","k2",...]} -> {"values":{"k1":"v1",...},"missing":["k2",...]}
+KvResponse kv_mget(const std::string& json_body, const std::string& client);
+// POST /mset {"k1":"v1","k2":"v2",...}, inserts or overwrites every pair
+KvResponse kv_mset(const std::string& json_body, const std::string& client);
+
+KvResponse kv_slab_stats();
+// GET /metrics, Prometheus text format (see metrics.h) plus slab usage
+KvResponse kv_metrics();
+// POST /admin/lock-profiling/{on|off}, see profiled_mutex.h
+KvResponse kv_lock_profiling(std::string_view state);
+// GET /admin/slow-requests, see slow_log.h
+KvResponse kv_slow_requests();
+// POST /admin/log-level/{debug|info|warn|error}, the runtime threshold (see logger.h)
+KvResponse kv_log_level(std::string_view level);
+// POST /admin/access-sample/{n}, log one access line in every n requests (0 = none)
+KvResponse kv_access_sample(std::string_view every);
+
+// value-level access for the non-HTTP protocols (see resp_service.h),
+// backed by the same cache and database as the routes above
+enum class KvStatus { OK, NOT_FOUND, UNAVAILABLE, FAILED };
+// cache only, never touches the database
+bool kv_value_cached(std::string_view key, SharedBuffer& value);
+// database read for a cache miss; the value found is cached
+KvStatus kv_value_load(const std::string& key, SharedBuffer& value);
+// insert or overwrite
+KvStatus kv_value_set(const std::string& key, const std::string& value);
+KvStatus kv_value_delete(const std::string& key);
+// batch variants: one cache lock pass, one database statement for everything else;
+// values[i] is null when keys[i] does not exist
+KvStatus kv_values_get(const std::vector<std::string>& keys, std::vector<SharedBuffer>& values);
+KvStatus kv_values_set(const std::vector<std::pair<std::string, std::string>>& items);
+
+// runs the handler for a matched route (see router.h); NOT_FOUND gives an empty 404.
+// cache_checked is set when kv_dispatch_cached already declined the request (see kv_get)
+KvResponse kv_handle(const RouteMatch& match, const std::string& body, const std::string& client, KvFormats formats = {},
+                     bool cache_checked = false);
+// match_route + kv_handle, for front ends that parse requests themselves
+KvResponse kv_dispatch(const std::string& method, const std::string& path, const std::string& body, const std::string& client,
+                       KvFormats formats = {}, bool cache_checked = false);
+
+// fast lane: answers the request if that needs no database call (cache hits, stats)
+// and returns false otherwise. Cheap enough to run on an event loop thread, so
+// hits are served there and only misses and writes reach the DB executor.
+bool kv_dispatch_cached(const std::string& method, const std::string& path, const std::string& client, KvResponse& res,
+                        KvFormat format = KvFormat::JSON);
+
+#endif
\ No newline at end of file
@@ -1,10 +1,208 @@
 #include "logger.h"
+#include "config.h"
 
-std::mutex log_mutex;
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <thread>
+
+ProfiledMutex log_mutex{MetricLock::LOG};
+std::atomic<int> log_level_threshold{LOG_LEVEL};
+std::atomic<uint32_t> log_access_sample_every{ACCESS_LOG_SAMPLE_EVERY};
+
+namespace {
+
+// bounded multi-producer single-consumer ring (D. Vyukov), same scheme as
+// the work-stealing pool's TaskRing with the consumer side left uncontended
+class LogRing {
+public:
+    explicit LogRing(size_t capacity) : cells(new Cell[capacity]), mask(capacity - 1) {
+        for (size_t i = 0; i < capacity; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(std::chrono::system_clock::time_point time, const std::string& text) {
+        Cell* cell;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->time = time;
+        cell->text.assign(text); // reuses the slot's capacity once warmed up
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // single consumer: hands the front record to fn, returns false when empty
+    template <typename Fn>
+    bool pop(Fn&& fn) {
+        Cell& cell = cells[dequeue_pos & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) return false;
+        fn(cell.time, cell.text);
+        cell.sequence.store(dequeue_pos + mask + 1, std::memory_order_release);
+        ++dequeue_pos;
+        return true;
+    }
+
+    size_t pending() const {
+        return enqueue_pos.load(std::memory_order_relaxed) - dequeue_pos;
+    }
+
+    size_t claimed() const { return enqueue_pos.load(std::memory_order_acquire); }
+    size_t consumed() const { return dequeue_pos; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        std::chrono::system_clock::time_point time;
+        std::string text;
+    };
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) size_t dequeue_pos = 0;
+};
+
+class AsyncLogger {
+public:
+    AsyncLogger() : ring(LOG_RING_CAPACITY), writer(&AsyncLogger::run, this) {
+        writer.detach();
+        std::atexit(log_flush);
+    }
+
+    void push(const std::string& message) {
+        if (!ring.push(std::chrono::system_clock::now(), message)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // the writer sleeps at most LOG_FLUSH_INTERVAL_MS; only nudge it when the ring fills up
+        if (ring.pending() == LOG_RING_CAPACITY / 2) wake.notify_one();
+    }
+
+    void flush() {
+        std::unique_lock<ProfiledMutex> lock(log_mutex);
+        size_t target = ring.claimed();
+        if (target > flush_target) flush_target = target;
+        wake.notify_one();
+        // bounded so a wedged stdout cannot hang exit
+        flushed.wait_for(lock, std::chrono::seconds(1), [&] { return written >= target; });
+    }
+
+    uint64_t dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    LogRing ring;
+    std::atomic<uint64_t> dropped{0};
+    uint64_t dropped_reported = 0;
+
+    std::condition_variable_any wake;
+    std::condition_variable_any flushed;
+    size_t flush_target = 0;  // records log_flush callers are waiting for
+    size_t written = 0;
+
+    // localtime_r only runs when the second changes
+    std::time_t stamp_second = -1;
+    char stamp[32] = {0};
+    size_t stamp_len = 0;
+
+    std::string out;
+    std::thread writer;
+
+    void append_stamp(std::chrono::system_clock::time_point time) {
+        std::time_t now_c = std::chrono::system_clock::to_time_t(time);
+        if (now_c != stamp_second) {
+            std::tm tm_buf;
+            localtime_r(&now_c, &tm_buf);
+            stamp_len = std::strftime(stamp, sizeof(stamp), "[%Y-%m-%d %H:%M:%S] ", &tm_buf);
+            stamp_second = now_c;
+        }
+        out.append(stamp, stamp_len);
+    }
+
+    void drain() {
+        out.clear();
+        while (ring.pop([this](std::chrono::system_clock::time_point time, const std::string& text) {
+                   append_stamp(time);
+                   out += text;
+                   out += '\n';
+               })) {
+            if (out.size() >= LOG_WRITE_BATCH) {
+                std::fwrite(out.data(), 1, out.size(), stdout);
+                out.clear();
+            }
+        }
+        uint64_t lost = dropped.load(std::memory_order_relaxed);
+        if (lost != dropped_reported) {
+            append_stamp(std::chrono::system_clock::now());
+            out += "Logger dropped " + std::to_string(lost - dropped_reported) + " messages (ring full)\n";
+            dropped_reported = lost;
+        }
+        if (!out.empty()) std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+    }
+
+    void run() {
+        for (;;) {
+            drain();
+            std::unique_lock<ProfiledMutex> lock(log_mutex);
+            written = ring.consumed();
+            if (flush_target != 0) flushed.notify_all();
+            if (written < flush_target) continue; // a producer is still publishing its record
+            flush_target = 0;
+            if (ring.pending() == 0) {
+                wake.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS),
+                              [this] { return flush_target != 0; });
+            }
+        }
+    }
+};
+
+// never destroyed: detached threads may still log while the process exits
+AsyncLogger& logger() {
+    static AsyncLogger* instance = new AsyncLogger();
+    return *instance;
+}
+
+} // namespace
 
 void log_message(const std::string& message) {
-    std::lock_guard<std::mutex> lock(log_mutex);
-    auto now = std::chrono::system_clock::now();
-    std::time_t now_c = std::chrono::system_clock::to_time_t(now);
-    std::cout << "[" << std::put_time(std::localtime(&now_c), "%Y-%m-%d %H:%M:%S") << "] " << message << std::endl;
-}
\ No newline at end of file
+    logger().push(message);
+}
+
+void log_flush() {
+    logger().flush();
+}
+
+uint64_t log_dropped_count() {
+    return logger().dropped_count();
+}
+
+void log_set_level(LogLevel level) {
+    log_level_threshold.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+void log_set_access_sample(uint32_t every_n) {
+    log_access_sample_every.store(every_n, std::memory_order_relaxed);
+}
+
+std::string log_request_prefix(std::string_view op, std::string_view key, std::string_view client) {
+    static constexpr std::string_view from = " from ";
+    std::string out;
+    out.reserve(op.size() + key.size() + from.size() + client.size() + 64); // room for the outcome
+    out.append(op).append(key).append(from).append(client);
+    return out;
+}
@@ -1,15 +1,87 @@
 #ifndef SERVER_LOGGER_H
 #define SERVER_LOGGER_H
 
-#include <string>
-#include <iostream>
-#include <chrono>
-#include <ctime>
-#include <iomanip>
+#include "profiled_mutex.h"
+
+#include <atomic>
+#include <cstdint>
 #include <mutex>
+#include <string>
+#include <string_view>
 
-extern std::mutex log_mutex;
+// Asynchronous logger. log_message stamps the record and pushes it into a
+// bounded lock-free ring; a background thread formats the records and
+// writes them to stdout in batches. When the ring is full the record is
+// dropped and counted, the request path never waits for the terminal.
+
+// guards the writer thread's sleep and log_flush, not the producers
+extern ProfiledMutex log_mutex;
 
 void log_message(const std::string& message);
 
-#endif
\ No newline at end of file
+// blocks until every record logged so far has been written (also runs at exit)
+void log_flush();
+
+uint64_t log_dropped_count();
+
+// Levels and sampling. Use the macros below instead of calling log_message
+// directly: the message expression is only evaluated when the record is
+// actually kept, so a disabled level costs one relaxed load and no string
+// building. Levels below LOG_COMPILED_LEVEL (and access lines when
+// LOG_ACCESS_COMPILED is 0) are removed by the compiler altogether, e.g.
+// make CXXFLAGS+="-DLOG_COMPILED_LEVEL=2 -DLOG_ACCESS_COMPILED=0".
+// DEBUG is compiled out unless the build sets -DLOG_COMPILED_LEVEL=0.
+
+enum class LogLevel : int { DEBUG = 0, INFO = 1, WARN = 2, ERROR = 3 };
+
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL 1
+#endif
+#ifndef LOG_ACCESS_COMPILED
+#define LOG_ACCESS_COMPILED 1
+#endif
+
+extern std::atomic<int> log_level_threshold;
+extern std::atomic<uint32_t> log_access_sample_every;
+
+void log_set_level(LogLevel level);
+// keep one access line in every n requests (0 = none)
+void log_set_access_sample(uint32_t every_n);
+
+inline bool log_enabled(LogLevel level) {
+    return static_cast<int>(level) >= log_level_threshold.load(std::memory_order_relaxed);
+}
+
+// per-thread counter, so sampling needs no shared write
+inline bool log_access_sampled() {
+    if (!log_enabled(LogLevel::INFO)) return false;
+    uint32_t every = log_access_sample_every.load(std::memory_order_relaxed);
+    if (every <= 1) return every == 1;
+    static thread_local uint32_t seen = 0;
+    if (++seen < every) return false;
+    seen = 0;
+    return true;
+}
+
+// "<op><key> from <client>", built in one allocation
+std::string log_request_prefix(std::string_view op, std::string_view key, std::string_view client);
+
+#define LOG_AT(level, expr)                                                                  \
+    do {                                                                                     \
+        if (static_cast<int>(level) >= LOG_COMPILED_LEVEL && log_enabled(level)) log_message(expr); \
+    } while (0)
+
+#define LOG_DEBUG(expr) LOG_AT(LogLevel::DEBUG, expr)
+#define LOG_INFO(expr) LOG_AT(LogLevel::INFO, expr)
+#define LOG_WARN(expr) LOG_AT(LogLevel::WARN, expr)
+#define LOG_ERROR(expr) LOG_AT(LogLevel::ERROR, expr)
+
+// one line per served request, INFO level and sampled
+#define LOG_ACCESS(expr)                                                                     \
+    do {                                                                                     \
+        if (LOG_ACCESS_COMPILED && static_cast<int>(LogLevel::INFO) >= LOG_COMPILED_LEVEL    \
+            && log_access_sampled())                                                         \
+            log_message(expr);                                                               \
+    } while (0)
+
+#endif
@@ -0,0 +1,312 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// bucket i < 4 holds i ns; above that, four equal buckets per power of two
+const size_t HIST_BUCKETS = 41 * 4;  // last bucket collects everything from ~1.1e12 ns up
+// buckets exported to Prometheus, 1.024 us .. 68.7 s; lower buckets fold into the first
+const size_t HIST_FIRST_EXPORTED = 35;
+const size_t HIST_LAST_EXPORTED = 139;
+
+const size_t OP_COUNT = static_cast<size_t>(AccessOp::COUNT);
+const int STATUS_CODES[] = {200, 201, 400, 404, 409, 500, 503};
+const size_t STATUS_SLOTS = sizeof(STATUS_CODES) / sizeof(STATUS_CODES[0]) + 1; // + other
+
+const size_t COUNTER_COUNT = static_cast<size_t>(MetricCounter::COUNT);
+const size_t STAGE_COUNT = static_cast<size_t>(MetricStage::COUNT);
+const size_t LOCK_COUNT = static_cast<size_t>(MetricLock::COUNT);
+
+struct HistogramData {
+    std::atomic<uint64_t> buckets[HIST_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum_ns;
+};
+
+// written only by its owning thread, read by the scraper
+struct alignas(64) MetricShard {
+    std::atomic<uint64_t> counters[COUNTER_COUNT];
+    std::atomic<uint64_t> requests[OP_COUNT][STATUS_SLOTS];
+    HistogramData request_latency[OP_COUNT];
+    HistogramData stages[STAGE_COUNT];
+    std::atomic<uint64_t> lock_acquired[LOCK_COUNT];
+    std::atomic<uint64_t> lock_contended[LOCK_COUNT];
+    HistogramData lock_wait[LOCK_COUNT];
+    HistogramData lock_hold[LOCK_COUNT];
+};
+
+thread_local StageTrace trace = {};
+
+std::mutex shards_mutex;
+std::vector<MetricShard*> shards;
+
+struct Registered {
+    std::string name;
+    std::string help;
+    MetricType type;
+    std::function<double()> read;
+};
+std::mutex registry_mutex;
+std::map<int, Registered> registry;
+int next_id = 0;
+
+// shards outlive their threads so nothing counted is lost
+MetricShard& shard() {
+    static thread_local MetricShard* mine = [] {
+        MetricShard* created = new MetricShard(); // value-initialized: all zero
+        std::lock_guard<std::mutex> lock(shards_mutex);
+        shards.push_back(created);
+        return created;
+    }();
+    return *mine;
+}
+
+// single writer per shard: a relaxed load and store, no locked instruction
+inline void add(std::atomic<uint64_t>& cell, uint64_t n) {
+    cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+size_t bucket_index(uint64_t ns) {
+    if (ns < 4) return static_cast<size_t>(ns);
+    size_t msb = 63 - static_cast<size_t>(__builtin_clzll(ns));
+    size_t index = (msb - 1) * 4 + ((ns >> (msb - 2)) & 3);
+    return std::min(index, HIST_BUCKETS - 1);
+}
+
+// exclusive upper bound of a bucket in ns
+uint64_t bucket_upper(size_t index) {
+    if (index < 4) return index + 1;
+    size_t msb = index / 4 + 1;
+    return (4 + index % 4 + 1) << (msb - 2);
+}
+
+void observe(HistogramData& h, uint64_t ns) {
+    add(h.buckets[bucket_index(ns)], 1);
+    add(h.count, 1);
+    add(h.sum_ns, ns);
+}
+
+size_t status_slot(int status) {
+    for (size_t i = 0; i + 1 < STATUS_SLOTS; ++i) {
+        if (STATUS_CODES[i] == status) return i;
+    }
+    return STATUS_SLOTS - 1;
+}
+
+struct HistogramTotals {
+    uint64_t buckets[HIST_BUCKETS] = {};
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+
+    void merge(const HistogramData& h) {
+        for (size_t i = 0; i < HIST_BUCKETS; ++i) buckets[i] += h.buckets[i].load(std::memory_order_relaxed);
+        count += h.count.load(std::memory_order_relaxed);
+        sum_ns += h.sum_ns.load(std::memory_order_relaxed);
+    }
+};
+
+void append_header(std::string& out, const char* name, const char* help, const char* type) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void append_number(std::string& out, double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.15g", value);
+    out += buf;
+}
+
+// labels is either empty or `key="value"`
+void append_histogram(std::string& out, const char* name, const std::string& labels, const HistogramTotals& h) {
+    std::string prefix = std::string(name) + "_bucket{" + labels + (labels.empty() ? "" : ",") + "le=\"";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < HIST_FIRST_EXPORTED; ++i) cumulative += h.buckets[i];
+    for (size_t i = HIST_FIRST_EXPORTED; i <= HIST_LAST_EXPORTED; ++i) {
+        cumulative += h.buckets[i];
+        char le[32];
+        std::snprintf(le, sizeof(le), "%.9g", bucket_upper(i) / 1e9);
+        out += prefix;
+        out += le;
+        out += "\"} ";
+        out += std::to_string(cumulative);
+        out += '\n';
+    }
+    out += prefix + "+Inf\"} " + std::to_string(h.count) + '\n';
+    std::string suffix = labels.empty() ? std::string(" ") : "{" + labels + "} ";
+    out += std::string(name) + "_sum" + suffix;
+    append_number(out, h.sum_ns / 1e9);
+    out += '\n';
+    out += std::string(name) + "_count" + suffix + std::to_string(h.count) + '\n';
+}
+
+const char* const COUNTER_NAMES[COUNTER_COUNT][2] = {
+    {"kv_cache_hits_total", "Cache lookups that found the key."},
+    {"kv_cache_misses_total", "Cache lookups that did not find the key."},
+    {"kv_cache_evictions_total", "Entries evicted to make room (LRU)."},
+    {"kv_db_calls_total", "Database calls that got a connection."},
+    {"kv_db_errors_total", "Database calls that failed."},
+    {"kv_db_rejected_total", "Database calls shed by admission control."},
+};
+
+const char* const STAGE_NAMES[STAGE_COUNT] = {"queue", "parse", "cache", "pool_wait", "db", "serialize", "write"};
+const char* const LOCK_NAMES[LOCK_COUNT] = {"cache", "pool", "log"};
+
+} // namespace
+
+void metrics_count(MetricCounter counter, uint64_t n) {
+    add(shard().counters[static_cast<size_t>(counter)], n);
+}
+
+void metrics_stage(MetricStage stage, uint64_t ns) {
+    observe(shard().stages[static_cast<size_t>(stage)], ns);
+    if (stage != MetricStage::WRITE) trace.ns[static_cast<size_t>(stage)] += ns;
+}
+
+const char* metrics_stage_name(MetricStage stage) {
+    return stage < MetricStage::COUNT ? STAGE_NAMES[static_cast<size_t>(stage)] : "?";
+}
+
+const StageTrace& metrics_trace() {
+    return trace;
+}
+
+void metrics_trace_reset() {
+    trace = {};
+}
+
+void metrics_lock_acquired(MetricLock lock, bool contended, uint64_t wait_ns) {
+    MetricShard& s = shard();
+    size_t index = static_cast<size_t>(lock);
+    add(s.lock_acquired[index], 1);
+    if (!contended) return;
+    add(s.lock_contended[index], 1);
+    observe(s.lock_wait[index], wait_ns);
+}
+
+void metrics_lock_held(MetricLock lock, uint64_t hold_ns) {
+    observe(shard().lock_hold[static_cast<size_t>(lock)], hold_ns);
+}
+
+void metrics_request(AccessOp op, int status, uint64_t latency_ns) {
+    MetricShard& s = shard();
+    size_t index = std::min(static_cast<size_t>(op), OP_COUNT - 1);
+    add(s.requests[index][status_slot(status)], 1);
+    observe(s.request_latency[index], latency_ns);
+}
+
+int metrics_register(const std::string& name, const std::string& help, std::function<double()> read, MetricType type) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    int id = next_id++;
+    registry[id] = {name, help, type, std::move(read)};
+    return id;
+}
+
+void metrics_unregister(int id) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.erase(id);
+}
+
+std::string metrics_render() {
+    uint64_t counters[COUNTER_COUNT] = {};
+    uint64_t requests[OP_COUNT][STATUS_SLOTS] = {};
+    std::vector<HistogramTotals> request_latency(OP_COUNT);
+    std::vector<HistogramTotals> stages(STAGE_COUNT);
+    uint64_t lock_acquired[LOCK_COUNT] = {};
+    uint64_t lock_contended[LOCK_COUNT] = {};
+    std::vector<HistogramTotals> lock_wait(LOCK_COUNT);
+    std::vector<HistogramTotals> lock_hold(LOCK_COUNT);
+    {
+        std::lock_guard<std::mutex> lock(shards_mutex);
+        for (const MetricShard* s : shards) {
+            for (size_t c = 0; c < COUNTER_COUNT; ++c) counters[c] += s->counters[c].load(std::memory_order_relaxed);
+            for (size_t op = 0; op < OP_COUNT; ++op) {
+                for (size_t st = 0; st < STATUS_SLOTS; ++st) requests[op][st] += s->requests[op][st].load(std::memory_order_relaxed);
+                request_latency[op].merge(s->request_latency[op]);
+            }
+            for (size_t st = 0; st < STAGE_COUNT; ++st) stages[st].merge(s->stages[st]);
+            for (size_t l = 0; l < LOCK_COUNT; ++l) {
+                lock_acquired[l] += s->lock_acquired[l].load(std::memory_order_relaxed);
+                lock_contended[l] += s->lock_contended[l].load(std::memory_order_relaxed);
+                lock_wait[l].merge(s->lock_wait[l]);
+                lock_hold[l].merge(s->lock_hold[l]);
+            }
+        }
+    }
+
+    std::string out;
+    out.reserve(64 * 1024);
+
+    append_header(out, "kv_requests_total", "Requests served, by operation and status code.", "counter");
+    for (size_t op = 0; op < OP_COUNT; ++op) {
+        for (size_t st = 0; st < STATUS_SLOTS; ++st) {
+            if (requests[op][st] == 0) continue;
+            out += "kv_requests_total{op=\"";
+            out += access_op_name(static_cast<AccessOp>(op));
+            out += "\",code=\"";
+            out += st + 1 < STATUS_SLOTS ? std::to_string(STATUS_CODES[st]) : "other";
+            out += "\"} " + std::to_string(requests[op][st]) + '\n';
+        }
+    }
+
+    append_header(out, "kv_request_duration_seconds", "Time spent handling a request, excluding queueing.", "histogram");
+    for (size_t op = 0; op < OP_COUNT; ++op) {
+        if (request_latency[op].count == 0) continue;
+        append_histogram(out, "kv_request_duration_seconds",
+                         std::string("op=\"") + access_op_name(static_cast<AccessOp>(op)) + "\"", request_latency[op]);
+    }
+
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        append_header(out, COUNTER_NAMES[c][0], COUNTER_NAMES[c][1], "counter");
+        out += std::string(COUNTER_NAMES[c][0]) + ' ' + std::to_string(counters[c]) + '\n';
+    }
+
+    append_header(out, "kv_stage_duration_seconds", "Time spent in each stage of request handling.", "histogram");
+    for (size_t st = 0; st < STAGE_COUNT; ++st) {
+        append_histogram(out, "kv_stage_duration_seconds", std::string("stage=\"") + STAGE_NAMES[st] + "\"", stages[st]);
+    }
+
+    // lock profiling, only counted while it is switched on
+    auto lock_label = [](size_t l) { return std::string("lock=\"") + LOCK_NAMES[l] + "\""; };
+    append_header(out, "kv_lock_acquisitions_total", "Profiled acquisitions of a global mutex.", "counter");
+    for (size_t l = 0; l < LOCK_COUNT; ++l) {
+        out += "kv_lock_acquisitions_total{" + lock_label(l) + "} " + std::to_string(lock_acquired[l]) + '\n';
+    }
+    append_header(out, "kv_lock_contended_total", "Profiled acquisitions that found the mutex held.", "counter");
+    for (size_t l = 0; l < LOCK_COUNT; ++l) {
+        out += "kv_lock_contended_total{" + lock_label(l) + "} " + std::to_string(lock_contended[l]) + '\n';
+    }
+    append_header(out, "kv_lock_wait_seconds", "Time blocked in contended acquisitions.", "histogram");
+    for (size_t l = 0; l < LOCK_COUNT; ++l) append_histogram(out, "kv_lock_wait_seconds", lock_label(l), lock_wait[l]);
+    append_header(out, "kv_lock_hold_seconds", "Time a profiled acquisition held the mutex.", "histogram");
+    for (size_t l = 0; l < LOCK_COUNT; ++l) append_histogram(out, "kv_lock_hold_seconds", lock_label(l), lock_hold[l]);
+
+    // registered values, same name summed, in name order
+    std::map<std::string, std::pair<const Registered*, double>> values;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (const auto& entry : registry) {
+        auto& slot = values[entry.second.name];
+        if (!slot.first) slot.first = &entry.second;
+        slot.second += entry.second.read();
+    }
+    for (const auto& value : values) {
+        const Registered& reg = *value.second.first;
+        append_header(out, reg.name.c_str(), reg.help.c_str(), reg.type == MetricType::COUNTER ? "counter" : "gauge");
+        out += reg.name + ' ';
+        append_number(out, value.second.second);
+        out += '\n';
+    }
+    return out;
+}
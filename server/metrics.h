@@ -0,0 +1,86 @@
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+
+#include "access_record.h"
+#include "stage_clock.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Server metrics in the Prometheus text format (GET /metrics).
+// Every thread writes to its own cache-line aligned shard with plain
+// relaxed stores, so recording is a few uncontended adds; a scrape walks
+// all shards and sums them. Latencies go into log-linear histograms
+// (four buckets per power of two of nanoseconds).
+
+enum class MetricCounter {
+    CACHE_HITS,
+    CACHE_MISSES,
+    CACHE_EVICTIONS,
+    DB_CALLS,
+    DB_ERRORS,
+    DB_REJECTED,    // shed by db_guard before reaching the pool
+    COUNT
+};
+
+// where a request spends its time, one histogram each (kv_stage_duration_seconds{stage})
+enum class MetricStage {
+    QUEUE,          // waiting in an executor queue for a worker thread
+    PARSE,          // parsing a request off the wire (epoll, io_uring and RESP front ends)
+    CACHE,          // cache lookup, including waiting for cache_mutex
+    POOL_WAIT,      // waiting for a free database connection
+    DB,             // database call, connection held
+    SERIALIZE,      // building a response body
+    WRITE,          // sending responses to the socket
+    COUNT
+};
+
+void metrics_count(MetricCounter counter, uint64_t n = 1);
+void metrics_stage(MetricStage stage, uint64_t ns);
+const char* metrics_stage_name(MetricStage stage);
+
+// start is a stage_now() reading
+inline void metrics_stage_since(MetricStage stage, uint64_t start) {
+    metrics_stage(stage, stage_elapsed_ns(start));
+}
+
+// Stage times observed on this thread since the last reset, for the slow
+// request log (see slow_log.h). Front ends reset it when a request leaves
+// the thread unfinished, the executor at the start of every task and the
+// request recorder after each request. WRITE is left out: it happens after
+// the request has been recorded.
+struct StageTrace {
+    uint64_t ns[static_cast<size_t>(MetricStage::COUNT)];
+};
+const StageTrace& metrics_trace();
+void metrics_trace_reset();
+
+// the instrumented global mutexes (see profiled_mutex.h)
+enum class MetricLock {
+    CACHE,          // cache_mutex
+    POOL,           // ConnectionPool::pool_mutex
+    LOG,            // log_mutex
+    COUNT
+};
+
+// kv_lock_acquisitions_total{lock}, kv_lock_contended_total{lock} and, for contended
+// acquisitions, kv_lock_wait_seconds{lock}
+void metrics_lock_acquired(MetricLock lock, bool contended, uint64_t wait_ns);
+// kv_lock_hold_seconds{lock}
+void metrics_lock_held(MetricLock lock, uint64_t hold_ns);
+
+// one served request: kv_requests_total{op,code} and kv_request_duration_seconds{op}
+void metrics_request(AccessOp op, int status, uint64_t latency_ns);
+
+// values read at scrape time (queue depths, cache size, counters kept elsewhere);
+// values registered under the same name are summed. Returns an id for
+// metrics_unregister.
+enum class MetricType { GAUGE, COUNTER };
+int metrics_register(const std::string& name, const std::string& help, std::function<double()> read,
+                     MetricType type = MetricType::GAUGE);
+void metrics_unregister(int id);
+
+std::string metrics_render();
+
+#endif
@@ -0,0 +1,26 @@
+#include "profiled_mutex.h"
+#include "config.h"
+
+std::atomic<bool> lock_profiling{LOCK_PROFILING};
+
+void lock_profiling_set(bool on) {
+    lock_profiling.store(on, std::memory_order_relaxed);
+}
+
+void ProfiledMutex::lock_profiled() {
+    if (inner.try_lock()) {
+        metrics_lock_acquired(id, false, 0);
+    } else {
+        uint64_t wait_start = stage_now();
+        inner.lock();
+        metrics_lock_acquired(id, true, stage_elapsed_ns(wait_start));
+    }
+    acquired = stage_now();
+}
+
+void ProfiledMutex::unlock_profiled() {
+    uint64_t hold_ns = stage_elapsed_ns(acquired);
+    acquired = 0;
+    inner.unlock();
+    metrics_lock_held(id, hold_ns);
+}
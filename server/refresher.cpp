@@ -0,0 +1,53 @@
+#include "refresher.h"
+#include "cache.h"
+#include "database.h"
+#include "logger.h"
+
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+static std::queue<std::string> refresh_queue;
+static std::mutex refresh_mutex;
+static std::condition_variable refresh_cond;
+
+static void refresh_loop() {
+    for (;;) {
+        std::string key;
+        {
+            std::unique_lock<std::mutex> lock(refresh_mutex);
+            refresh_cond.wait(lock, [] { return !refresh_queue.empty(); });
+            key = std::move(refresh_queue.front());
+            refresh_queue.pop();
+        }
+
+        std::string value = db_read(key);
+        bool failed = value.empty() && db_call_failed();
+        SharedBuffer fresh = value.empty() ? nullptr : make_shared_buffer(value);
+
+        std::lock_guard<ProfiledMutex> lock(cache_mutex);
+        if (failed) {
+            // database unavailable or the read failed, keep serving the stale value and let a later reader retry
+            cache_cancel_refresh(key);
+        } else {
+            cache_apply_refresh(key, std::move(fresh));
+        }
+    }
+}
+
+void refresher_init() {
+    static std::once_flag started;
+    std::call_once(started, [] {
+        std::thread(refresh_loop).detach();
+        LOG_INFO("Cache refresher started.");
+    });
+}
+
+void refresher_schedule(const std::string& key) {
+    {
+        std::lock_guard<std::mutex> lock(refresh_mutex);
+        refresh_queue.push(key);
+    }
+    refresh_cond.notify_one();
+}
@@ -0,0 +1,13 @@
+#ifndef SERVER_REFRESHER_H
+#define SERVER_REFRESHER_H
+
+#include <string>
+
+// Background refresh of stale cache entries (stale-while-revalidate).
+// Readers keep getting the stale value while a single refresher thread
+// fetches the new one from the database.
+
+void refresher_init();
+void refresher_schedule(const std::string& key);
+
+#endif
@@ -0,0 +1,100 @@
+#include "resp_codec.h"
+#include "config.h"
+
+// reads the CRLF-terminated length that follows a type byte ('*' or '$')
+static ParseStatus read_length(const std::string& buf, size_t pos, size_t& n, size_t& next) {
+    size_t end = buf.find("\r\n", pos);
+    if (end == std::string::npos) return buf.size() - pos > 20 ? ParseStatus::BAD : ParseStatus::INCOMPLETE;
+    if (end == pos || end - pos > 18) return ParseStatus::BAD;
+
+    n = 0;
+    for (size_t i = pos; i < end; ++i) {
+        if (buf[i] < '0' || buf[i] > '9') return ParseStatus::BAD; // commands never carry negative lengths
+        n = n * 10 + (buf[i] - '0');
+    }
+    next = end + 2;
+    return ParseStatus::OK;
+}
+
+static ParseStatus parse_inline(const std::string& buf, std::vector<std::string>& args, size_t& consumed) {
+    size_t end = buf.find('\n');
+    if (end == std::string::npos) {
+        return buf.size() > RESP_MAX_BULK_SIZE ? ParseStatus::BAD : ParseStatus::INCOMPLETE;
+    }
+    size_t line_end = end > 0 && buf[end - 1] == '\r' ? end - 1 : end;
+    size_t pos = 0;
+    while (pos < line_end) {
+        while (pos < line_end && (buf[pos] == ' ' || buf[pos] == '\t')) ++pos;
+        size_t start = pos;
+        while (pos < line_end && buf[pos] != ' ' && buf[pos] != '\t') ++pos;
+        if (pos > start) args.emplace_back(buf, start, pos - start);
+    }
+    consumed = end + 1;
+    return ParseStatus::OK;
+}
+
+ParseStatus parse_resp_command(const std::string& buf, std::vector<std::string>& args, size_t& consumed) {
+    args.clear();
+    if (buf.empty()) return ParseStatus::INCOMPLETE;
+    if (buf[0] != '*') return parse_inline(buf, args, consumed);
+
+    size_t pos = 0;
+    size_t count = 0;
+    ParseStatus status = read_length(buf, 1, count, pos);
+    if (status != ParseStatus::OK) return status;
+    if (count > RESP_MAX_ARGS) return ParseStatus::BAD;
+
+    args.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (pos >= buf.size()) return ParseStatus::INCOMPLETE;
+        if (buf[pos] != '$') return ParseStatus::BAD;
+        size_t len = 0;
+        status = read_length(buf, pos + 1, len, pos);
+        if (status != ParseStatus::OK) return status;
+        if (len > RESP_MAX_BULK_SIZE || pos + len + 2 > RESP_MAX_COMMAND_SIZE) return ParseStatus::BAD;
+        if (buf.size() < pos + len + 2) return ParseStatus::INCOMPLETE;
+        if (buf[pos + len] != '\r' || buf[pos + len + 1] != '\n') return ParseStatus::BAD;
+        args.emplace_back(buf, pos, len);
+        pos += len + 2;
+    }
+    consumed = pos;
+    return ParseStatus::OK;
+}
+
+std::string resp_simple(std::string_view s) {
+    std::string out = "+";
+    out.append(s);
+    out += "\r\n";
+    return out;
+}
+
+std::string resp_error(std::string_view msg) {
+    std::string out = "-ERR ";
+    out.append(msg);
+    out += "\r\n";
+    return out;
+}
+
+std::string resp_integer(long long n) {
+    return ":" + std::to_string(n) + "\r\n";
+}
+
+std::string resp_bulk(std::string_view data) {
+    std::string out = "$" + std::to_string(data.size()) + "\r\n";
+    out.reserve(out.size() + data.size() + 2);
+    out.append(data);
+    out += "\r\n";
+    return out;
+}
+
+std::string resp_null() {
+    return "$-1\r\n";
+}
+
+std::string resp_empty_array() {
+    return "*0\r\n";
+}
+
+std::string resp_array_header(size_t count) {
+    return "*" + std::to_string(count) + "\r\n";
+}
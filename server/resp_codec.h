@@ -0,0 +1,25 @@
+#ifndef SERVER_RESP_CODEC_H
+#define SERVER_RESP_CODEC_H
+
+#include "http_codec.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Redis serialization protocol (RESP2): command parser and reply formatters.
+// Commands arrive as arrays of bulk strings, or as one space-separated
+// line ("inline" commands, as typed into telnet).
+
+// parses one command from the front of buf; on OK, consumed is the number of bytes it used
+ParseStatus parse_resp_command(const std::string& buf, std::vector<std::string>& args, size_t& consumed);
+
+std::string resp_simple(std::string_view s);   // +OK
+std::string resp_error(std::string_view msg);  // -ERR msg
+std::string resp_integer(long long n);         // :1
+std::string resp_bulk(std::string_view data);  // $len + data
+std::string resp_null();                       // $-1, missing key
+std::string resp_empty_array();                // *0
+std::string resp_array_header(size_t count);   // *count, the elements follow
+
+#endif
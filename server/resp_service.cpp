@@ -0,0 +1,223 @@
+#include "resp_service.h"
+#include "access_log.h"
+#include "kv_service.h"
+#include "logger.h"
+#include "metrics.h"
+#include "config.h"
+#include "resp_codec.h"
+#include "slow_log.h"
+
+#include <strings.h>
+
+static bool command_is(const std::vector<std::string>& args, const char* name) {
+    return !args.empty() && strcasecmp(args[0].c_str(), name) == 0;
+}
+
+static std::string wrong_arity(const std::string& command) {
+    return resp_error("wrong number of arguments for '" + command + "' command");
+}
+
+static std::string db_unavailable() {
+    return resp_error("database unavailable");
+}
+
+bool resp_is_read_only(const std::vector<std::string>& args) {
+    return !command_is(args, "SET") && !command_is(args, "DEL") && !command_is(args, "MSET");
+}
+
+static AccessOp access_op(const std::vector<std::string>& args) {
+    if (command_is(args, "GET")) return AccessOp::RESP_GET;
+    if (command_is(args, "SET")) return AccessOp::RESP_SET;
+    if (command_is(args, "DEL")) return AccessOp::RESP_DEL;
+    if (command_is(args, "MGET")) return AccessOp::RESP_MGET;
+    if (command_is(args, "MSET")) return AccessOp::RESP_MSET;
+    return AccessOp::RESP_OTHER;
+}
+
+// request metrics, the slow request log and the binary access log; RESP has no status codes, so
+// a reply counts as 200, nil as 404 and an error as 500
+static void record_command(const std::vector<std::string>& args, const std::string& client, const std::string& reply,
+                           AccessSource source, uint64_t start) {
+    int status = 200;
+    if (!reply.empty() && reply[0] == '-') status = 500;
+    else if (reply.compare(0, 3, "$-1") == 0) status = 404;
+    AccessOp op = access_op(args);
+    std::string_view key;
+    if (args.size() > 1 && op != AccessOp::RESP_MGET && op != AccessOp::RESP_MSET) key = args[1];
+    uint64_t latency_ns = stage_elapsed_ns(start);
+    metrics_request(op, status, latency_ns);
+    slow_log_offer(op, key, status, latency_ns, client, metrics_trace());
+    metrics_trace_reset();
+    if (access_log_enabled()) access_log_write(op, key, status, source, latency_ns, client);
+}
+
+static std::string execute_command(const std::vector<std::string>& args, const std::string& client, AccessSource& source,
+                                   bool cache_checked = false);
+
+bool resp_execute_cached(const std::vector<std::string>& args, const std::string& client, std::string& reply) {
+    if (command_is(args, "PING")) {
+        reply = resp_execute(args, client);
+        return true;
+    }
+    if (!command_is(args, "GET") || args.size() != 2) {
+        metrics_trace_reset();
+        return false;
+    }
+
+    uint64_t start = stage_now();
+    SharedBuffer value;
+    if (!kv_value_cached(args[1], value)) {
+        metrics_trace_reset(); // the executor traces the retry from scratch
+        return false;
+    }
+    reply = resp_bulk(std::string_view(value->data(), value->size()));
+    LOG_ACCESS(log_request_prefix("RESP GET ", args[1], client) + " -> Source: cache");
+    record_command(args, client, reply, AccessSource::CACHE, start);
+    return true;
+}
+
+std::string resp_execute(const std::vector<std::string>& args, const std::string& client, bool cache_checked) {
+    AccessSource source = AccessSource::NONE;
+    if (args.empty()) return execute_command(args, client, source);
+    uint64_t start = stage_now();
+    std::string reply = execute_command(args, client, source, cache_checked);
+    record_command(args, client, reply, source, start);
+    return reply;
+}
+
+static std::string execute_command(const std::vector<std::string>& args, const std::string& client, AccessSource& source,
+                                   bool cache_checked) {
+    if (args.empty()) return ""; // blank inline line, no reply
+
+    if (command_is(args, "PING")) {
+        if (args.size() > 2) return wrong_arity(args[0]);
+        return args.size() == 2 ? resp_bulk(args[1]) : resp_simple("PONG");
+    }
+
+    if (command_is(args, "GET")) {
+        if (args.size() != 2) return wrong_arity(args[0]);
+        const std::string& key = args[1];
+        auto log_msg_prefix = [&] { return log_request_prefix("RESP GET ", key, client); }; // only built for logged requests
+        SharedBuffer value;
+        if (!cache_checked && kv_value_cached(key, value)) {
+            source = AccessSource::CACHE;
+            LOG_ACCESS(log_msg_prefix() + " -> Source: cache");
+            return resp_bulk(std::string_view(value->data(), value->size()));
+        }
+        source = AccessSource::DATABASE;
+        KvStatus status = kv_value_load(key, value); // cache miss, goto database
+        if (status == KvStatus::OK) {
+            LOG_ACCESS(log_msg_prefix() + " -> Source: database (cache miss)");
+            return resp_bulk(std::string_view(value->data(), value->size()));
+        }
+        if (status == KvStatus::UNAVAILABLE) {
+            LOG_WARN(log_msg_prefix() + " -> Error: Database unavailable");
+            return db_unavailable();
+        }
+        LOG_ACCESS(log_msg_prefix() + " -> Source: not found");
+        return resp_null();
+    }
+
+    if (command_is(args, "SET")) {
+        if (args.size() != 3) return wrong_arity(args[0]);
+        const std::string& key = args[1];
+        auto log_msg_prefix = [&] { return log_request_prefix("RESP SET ", key, client); };
+        if (args[2].empty()) {
+            // the database layer cannot tell an empty value from a missing key
+            LOG_ACCESS(log_msg_prefix() + " -> Error: empty value");
+            return resp_error("empty values are not supported");
+        }
+        source = AccessSource::DATABASE;
+        KvStatus status = kv_value_set(key, args[2]);
+        if (status == KvStatus::OK) {
+            LOG_ACCESS(log_msg_prefix() + " -> Action: Stored (DB+Cache)");
+            return resp_simple("OK");
+        }
+        if (status == KvStatus::UNAVAILABLE) {
+            LOG_WARN(log_msg_prefix() + " -> Error: Database unavailable");
+            return db_unavailable();
+        }
+        LOG_ERROR(log_msg_prefix() + " -> Error: DB write failed");
+        return resp_error("failed to store in database");
+    }
+
+    if (command_is(args, "DEL")) {
+        if (args.size() < 2) return wrong_arity(args[0]);
+        source = AccessSource::DATABASE;
+        long long deleted = 0;
+        for (size_t i = 1; i < args.size(); ++i) {
+            auto log_msg_prefix = [&] { return log_request_prefix("RESP DEL ", args[i], client); };
+            KvStatus status = kv_value_delete(args[i]);
+            if (status == KvStatus::OK) {
+                ++deleted;
+                LOG_ACCESS(log_msg_prefix() + " -> Action: Deleted (DB+Cache)");
+            } else if (status == KvStatus::UNAVAILABLE) {
+                LOG_WARN(log_msg_prefix() + " -> Error: Database unavailable");
+                return db_unavailable();
+            } else if (status == KvStatus::FAILED) {
+                LOG_ERROR(log_msg_prefix() + " -> Error: DB delete failed");
+                return resp_error("failed to delete key from database");
+            } else {
+                LOG_ACCESS(log_msg_prefix() + " -> Error: Not Found (Key missing)");
+            }
+        }
+        return resp_integer(deleted);
+    }
+
+    if (command_is(args, "MGET")) {
+        if (args.size() < 2 || args.size() - 1 > BATCH_MAX_KEYS) return wrong_arity(args[0]);
+        std::vector<std::string> keys(args.begin() + 1, args.end());
+        std::vector<SharedBuffer> values;
+        KvStatus status = kv_values_get(keys, values);
+        auto log_msg_prefix = [&] { return log_request_prefix("RESP MGET", {}, client); };
+        if (status != KvStatus::OK) {
+            if (status == KvStatus::UNAVAILABLE) {
+                LOG_WARN(log_msg_prefix() + " -> Error: Database unavailable");
+                return db_unavailable();
+            }
+            LOG_ERROR(log_msg_prefix() + " -> Error: DB read failed");
+            return resp_error("failed to read from database");
+        }
+        std::string reply = resp_array_header(values.size());
+        size_t found = 0;
+        for (const SharedBuffer& value : values) {
+            if (value) {
+                ++found;
+                reply += resp_bulk(std::string_view(value->data(), value->size()));
+            } else {
+                reply += resp_null();
+            }
+        }
+        LOG_ACCESS(log_msg_prefix() + " -> Keys: " + std::to_string(keys.size()) + ", Found: " + std::to_string(found));
+        return reply;
+    }
+
+    if (command_is(args, "MSET")) {
+        if (args.size() < 3 || args.size() % 2 == 0 || (args.size() - 1) / 2 > BATCH_MAX_KEYS) return wrong_arity(args[0]);
+        std::vector<std::pair<std::string, std::string>> items;
+        for (size_t i = 1; i < args.size(); i += 2) {
+            if (args[i + 1].empty()) return resp_error("empty values are not supported");
+            items.emplace_back(args[i], args[i + 1]);
+        }
+        source = AccessSource::DATABASE;
+        KvStatus status = kv_values_set(items);
+        auto log_msg_prefix = [&] { return log_request_prefix("RESP MSET", {}, client); };
+        if (status == KvStatus::OK) {
+            LOG_ACCESS(log_msg_prefix() + " -> Action: Stored " + std::to_string(items.size()) + " (DB+Cache)");
+            return resp_simple("OK");
+        }
+        if (status == KvStatus::UNAVAILABLE) {
+            LOG_WARN(log_msg_prefix() + " -> Error: Database unavailable");
+            return db_unavailable();
+        }
+        LOG_ERROR(log_msg_prefix() + " -> Error: DB write failed");
+        return resp_error("failed to store in database");
+    }
+
+    // redis-cli and redis-benchmark query these on connect; an empty answer is enough for both
+    if (command_is(args, "COMMAND") || command_is(args, "CONFIG")) {
+        return resp_empty_array();
+    }
+
+    return resp_error("unknown command '" + args[0] + "'");
+}
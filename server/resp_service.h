@@ -0,0 +1,23 @@
+#ifndef SERVER_RESP_SERVICE_H
+#define SERVER_RESP_SERVICE_H
+
+#include <string>
+#include <vector>
+
+// Commands of the RESP listener: GET, SET, DEL, MGET, MSET and PING, plus enough of
+// COMMAND/CONFIG for redis-cli and redis-benchmark to connect. Keys and
+// values go through kv_service, so they are shared with the HTTP routes.
+// args[0] is the command name (any case); replies are RESP-encoded.
+
+// fast lane: answers commands that need no database call (GET hits, PING)
+// and returns false otherwise; cheap enough to run on an event loop thread
+bool resp_execute_cached(const std::vector<std::string>& args, const std::string& client, std::string& reply);
+
+// true for commands that do not change any data
+bool resp_is_read_only(const std::vector<std::string>& args);
+
+// runs any command, may block on the database; cache_checked is set when
+// resp_execute_cached already missed the cache for this command
+std::string resp_execute(const std::vector<std::string>& args, const std::string& client, bool cache_checked = false);
+
+#endif
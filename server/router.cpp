@@ -0,0 +1,52 @@
+#include "router.h"
+
+namespace {
+
+struct RouteEntry {
+    std::string_view method;
+    std::string_view pattern; // exact path, or the prefix before {key}
+    bool has_key;             // {key} is one non-empty path segment after the prefix
+    Route route;
+};
+
+const RouteEntry ROUTES[] = {
+    {"GET",    "/kv/",         true,  Route::KV_GET},
+    {"POST",   "/kv/",         true,  Route::KV_CREATE},
+    {"PUT",    "/kv/",         true,  Route::KV_UPDATE},
+    {"DELETE", "/kv/",         true,  Route::KV_DELETE},
+    {"POST",   "/mget",        false, Route::KV_MGET},
+    {"POST",   "/mset",        false, Route::KV_MSET},
+    {"GET",    "/stats/slabs", false, Route::SLAB_STATS},
+    {"GET",    "/metrics",     false, Route::METRICS},
+    {"POST",   "/admin/lock-profiling/", true, Route::LOCK_PROFILING},
+    {"GET",    "/admin/slow-requests",   false, Route::SLOW_REQUESTS},
+    {"POST",   "/admin/log-level/",      true,  Route::LOG_LEVEL},
+    {"POST",   "/admin/access-sample/",  true,  Route::ACCESS_SAMPLE},
+};
+
+} // namespace
+
+RouteMatch match_route(std::string_view method, std::string_view path) {
+    RouteMatch match;
+    for (const RouteEntry& entry : ROUTES) {
+        if (entry.method != method) continue;
+        if (!entry.has_key) {
+            if (path == entry.pattern) {
+                match.route = entry.route;
+                return match;
+            }
+            continue;
+        }
+        if (path.size() <= entry.pattern.size() || path.compare(0, entry.pattern.size(), entry.pattern) != 0) continue;
+        std::string_view key = path.substr(entry.pattern.size());
+        if (key.find('/') != std::string_view::npos) continue;
+        match.route = entry.route;
+        match.key = key;
+        return match;
+    }
+    return match;
+}
+
+bool route_is_read_only(Route route) {
+    return route != Route::KV_CREATE && route != Route::KV_UPDATE && route != Route::KV_DELETE && route != Route::KV_MSET;
+}
@@ -0,0 +1,37 @@
+#ifndef SERVER_ROUTER_H
+#define SERVER_ROUTER_H
+
+#include <string_view>
+
+// Route table shared by all front ends. Matching is a linear scan of
+// fixed prefixes with no regex and no allocation; the key is returned as
+// a view into the request path, so the path must outlive the match.
+
+enum class Route {
+    NOT_FOUND,
+    KV_GET,      // GET    /kv/{key}
+    KV_CREATE,   // POST   /kv/{key}
+    KV_UPDATE,   // PUT    /kv/{key}
+    KV_DELETE,   // DELETE /kv/{key}
+    KV_MGET,     // POST   /mget
+    KV_MSET,     // POST   /mset
+    SLAB_STATS,  // GET    /stats/slabs
+    METRICS,     // GET    /metrics
+    LOCK_PROFILING, // POST   /admin/lock-profiling/{on|off}
+    SLOW_REQUESTS,  // GET    /admin/slow-requests
+    LOG_LEVEL,      // POST   /admin/log-level/{debug|info|warn|error}
+    ACCESS_SAMPLE   // POST   /admin/access-sample/{n}
+};
+
+struct RouteMatch {
+    Route route = Route::NOT_FOUND;
+    std::string_view key; // the {key} segment, empty for routes without one
+};
+
+// path is percent-decoded and has no query string
+RouteMatch match_route(std::string_view method, std::string_view path);
+
+// true for routes that do not change any data (unknown routes included)
+bool route_is_read_only(Route route);
+
+#endif
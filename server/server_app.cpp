@@ -1,182 +1,156 @@
 #include "server_app.h"
 #include "config.h"
-#include "cache.h"
-#include "database.h"
+#include "event_server.h"
+#include "uring_server.h"
 #include "logger.h"
-
-#include <mysql_driver.h>
+#include "work_stealing_pool.h"
 
 // default constructor
 ServerApp::ServerApp() {
 
 }
 
-void ServerApp::init(int num_threads) {
+void ServerApp::init(int num_threads, Frontend frontend) {
 
     server_threads = num_threads;
+    this->frontend = frontend;
+
+    LOG_INFO("Initializing ServerApp...");
 
-    log_message("Initializing ServerApp...");
+    kv_service_init();
 
-    // Initialize Database Connection Pool
-    // We create as many DB connections as there are worker threads to minimize waiting
-    log_message("Initializing MySQL connection pool with " + std::to_string(50) + " connections...");
-    db_init(50);
+    if (frontend != Frontend::HTTPLIB) {
+        return; // EventServer is set up in run()
+    }
 
-    log_message("Configuring httplib server with a thread pool of size " + std::to_string(server_threads));
+    LOG_INFO("Configuring httplib server with a thread pool of size " + std::to_string(server_threads));
     svr.new_task_queue = [this] {
-        return new httplib::ThreadPool(server_threads);
+        return new WorkStealingPool(server_threads);
     };
 
-    // GET /kv/{key}
-    svr.Get("/kv/([^/]+)", [&](const httplib::Request& req, httplib::Response& res) {
-        std::string key = req.matches[1];
-        std::string log_msg_prefix = "GET /kv/" + key + " from " + req.remote_addr + ":" + std::to_string(req.remote_port);
-
-        std::string value;
-        std::string source_str;
-        {
-            std::lock_guard<std::mutex> lock(cache_mutex);
-            value = cache_get(key); // checking in cache
+    // requests are matched by the shared router (router.h) before httplib's own routing,
+    // which would run std::regex_match against every registered pattern
+    svr.set_pre_routing_handler([&](const httplib::Request& req, httplib::Response& res) {
+        // httplib reads the body only after this hook, those requests go to the handlers below
+        if (req.get_header_value_u64("Content-Length") > 0 || req.has_header("Transfer-Encoding")) {
+            return httplib::Server::HandlerResponse::Unhandled;
         }
-
-        if (!value.empty()) { // found in cache
-            res.status = 200;
-            source_str = "cache";
-            res.set_content("{\"key\":\"" + key + "\", \"value\":\"" + value + "\", \"source\":\"cache\"}", "application/json");
-        } else {
-            // cache miss, goto database
-            value = db_read(key);
-            if (!value.empty()) { // found in database
-                res.status = 200;
-                source_str = "database (cache miss)";
-                res.set_content("{\"key\":\"" + key + "\", \"value\":\"" + value + "\", \"source\":\"database\"}", "application/json");
-                {
-                    std::lock_guard<std::mutex> lock(cache_mutex); 
-                    cache_put(key, value); // update cache
-                }
-            } else { //not found in database
-                res.status = 404;
-                source_str = "not found";
-                res.set_content("{\"error\":\"Key not found\"}", "application/json");
-            }
-        }
-        log_message(log_msg_prefix + " -> Status: " + std::to_string(res.status) + ", Source: " + source_str);
+        return route(req, res) ? httplib::Server::HandlerResponse::Handled
+                               : httplib::Server::HandlerResponse::Unhandled;
     });
 
-    // POST /kv/{key}
-    svr.Post("/kv/([^/]+)", [&](const httplib::Request& req, httplib::Response& res) {
-        std::string key = req.matches[1];
-        std::string log_msg_prefix = "POST /kv/" + key + " from " + req.remote_addr + ":" + std::to_string(req.remote_port);
-
-        std::string value_from_body = extract_value_from_json(req.body);
-        if (value_from_body.empty()) {
-            res.status = 400;
-            res.set_content("{\"error\":\"Missing value in request body or invalid JSON format\"}", "application/json");
-            log_message(log_msg_prefix + " -> Status: " + std::to_string(res.status) + ", Error: Bad Request (missing value)");
-            return;
-        }
+    // any request with a body, GET and DELETE included (the body is ignored there);
+    // no route has more than three path segments, and ":param" patterns are
+    // matched without std::regex
+    auto with_body = [this](const httplib::Request& req, httplib::Response& res) {
+        if (!route(req, res)) res.status = 404;
+    };
+    for (const char* pattern : {"/:a", "/:a/:b", "/:a/:b/:c"}) {
+        svr.Get(pattern, with_body);
+        svr.Post(pattern, with_body);
+        svr.Put(pattern, with_body);
+        svr.Delete(pattern, with_body);
+    }
+}
 
-        if (db_create(key, value_from_body)) {
-            res.status = 201; 
-            res.set_content("{\"message\":\"Key-value pair created\"}", "application/json");
-            {
-                //std::lock_guard<std::mutex> lock(cache_mutex);
-                //cache_put(key, value_from_body); 
-            }
-            log_message(log_msg_prefix + " -> Status: " + std::to_string(res.status) + ", Action: Created (DB+Cache)");
-        } else {
-            if (db_key_exists(key)) {
-                res.status = 409;
-                res.set_content("{\"error\":\"Key already exists. Use PUT to update.\"}", "application/json");
-                log_message(log_msg_prefix + " -> Status: " + std::to_string(res.status) + ", Error: Conflict (Key exists)");
-            } else {
-                res.status = 500;
-                res.set_content("{\"error\":\"Failed to store in database\"}", "application/json");
-                log_message(log_msg_prefix + " -> Status: " + std::to_string(res.status) + ", Error: DB write failed");
-            }
-        }
-    });
+void ServerApp::run() {
+    if (frontend == Frontend::URING && !UringServer::supported()) {
+        LOG_WARN("io_uring (multishot recv, provided buffers) is not available on this kernel, falling back to epoll.");
+        frontend = Frontend::EPOLL;
+    }
 
-    // PUT /kv/{key}
-    svr.Put("/kv/([^/]+)", [&](const httplib::Request& req, httplib::Response& res) {
-        std::string key = req.matches[1];
-        std::string log_msg_prefix = "PUT /kv/" + key + " from " + req.remote_addr + ":" + std::to_string(req.remote_port);
-
-        std::string value_from_body = extract_value_from_json(req.body);
-        if (value_from_body.empty()) {
-            res.status = 400;
-            res.set_content("{\"error\":\"Missing value in request body or invalid JSON format\"}", "application/json");
-            log_message(log_msg_prefix + " -> Status: " + std::to_string(res.status) + ", Error: Bad Request (missing value)");
-            return;
+    if (frontend != Frontend::HTTPLIB || RESP_PORT > 0) {
+        executor.reset(new WorkStealingPool(frontend == Frontend::REUSEPORT ? REUSEPORT_DB_THREADS : server_threads));
+    }
+    start_resp_listener();
+
+    if (frontend == Frontend::URING) {
+        LOG_INFO("Server starting with " + std::to_string(EVENT_LOOP_THREADS) + " io_uring rings and " + std::to_string(server_threads) + " DB threads.");
+        LOG_INFO("Listening on 0.0.0.0:" + std::to_string(SERVER_PORT));
+
+        UringServer uring_server(EVENT_LOOP_THREADS, *executor);
+        if (!uring_server.listen("0.0.0.0", SERVER_PORT)) {
+            LOG_ERROR("ERROR: Server failed to start or encountered an error.");
+            exit(1);
         }
+        return;
+    }
 
-        if (db_update(key, value_from_body)) {
-            res.status = 200;
-            res.set_content("{\"message\":\"Key-value pair updated\"}", "application/json");
-            {
-                std::lock_guard<std::mutex> lock(cache_mutex);
-                cache_put(key, value_from_body); 
-            }
-            log_message(log_msg_prefix + " -> Status: " + std::to_string(res.status) + ", Action: Updated (DB+Cache)");
-        } else {
-            if (!db_key_exists(key)) {
-                res.status = 404; 
-                res.set_content("{\"error\":\"Key not found. Use POST to create.\"}", "application/json");
-                log_message(log_msg_prefix + " -> Status: " + std::to_string(res.status) + ", Error: Not Found (Key missing)");
-            } else {
-                res.status = 500;
-                res.set_content("{\"error\":\"Failed to update in database\"}", "application/json");
-                log_message(log_msg_prefix + " -> Status: " + std::to_string(res.status) + ", Error: DB update failed");
-            }
+    if (frontend == Frontend::REUSEPORT) {
+        LOG_INFO("Server starting with " + std::to_string(server_threads) + " per-core event loops (SO_REUSEPORT, cache hits served on the loop thread) and " + std::to_string(REUSEPORT_DB_THREADS) + " DB threads.");
+        LOG_INFO("Listening on 0.0.0.0:" + std::to_string(SERVER_PORT));
+
+        EventServer event_server(server_threads, *executor, true);
+        if (!event_server.listen("0.0.0.0", SERVER_PORT)) {
+            LOG_ERROR("ERROR: Server failed to start or encountered an error.");
+            exit(1);
         }
-    });
+        return;
+    }
 
-    // DELETE /kv/{key}
-    svr.Delete("/kv/([^/]+)", [&](const httplib::Request& req, httplib::Response& res) {
-        std::string key = req.matches[1];
-        std::string log_msg_prefix = "DELETE /kv/" + key + " from " + req.remote_addr + ":" + std::to_string(req.remote_port);
-
-        if (db_delete(key)) {
-            res.status = 200;
-            res.set_content("{\"message\":\"Key-value pair deleted\"}", "application/json");
-            {
-                std::lock_guard<std::mutex> lock(cache_mutex);
-                cache_delete(key); 
-            }
-            log_message(log_msg_prefix + " -> Status: " + std::to_string(res.status) + ", Action: Deleted (DB+Cache)");
-        } else {
-            if (!db_key_exists(key)) {
-                 res.status = 200;
-                 res.set_content("{\"error\":\"Key not found\"}", "application/json");
-                 log_message(log_msg_prefix + " -> Status: " + std::to_string(res.status) + ", Error: Not Found (Key missing)");
-            } else {
-                res.status = 500;
-                res.set_content("{\"error\":\"Failed to delete key from database\"}", "application/json");
-                log_message(log_msg_prefix + " -> Status: " + std::to_string(res.status) + ", Error: DB delete failed");
-            }
+    if (frontend == Frontend::EPOLL) {
+        LOG_INFO("Server starting with " + std::to_string(EVENT_LOOP_THREADS) + " epoll event loops and " + std::to_string(server_threads) + " DB threads.");
+        LOG_INFO("Listening on 0.0.0.0:" + std::to_string(SERVER_PORT));
+
+        EventServer event_server(EVENT_LOOP_THREADS, *executor);
+        if (!event_server.listen("0.0.0.0", SERVER_PORT)) {
+            LOG_ERROR("ERROR: Server failed to start or encountered an error.");
+            exit(1);
         }
-    });
-}
+        return;
+    }
 
-void ServerApp::run() {
-    log_message("Server starting with " + std::to_string(server_threads) + " worker threads.");
-    log_message("Listening on 0.0.0.0:" + std::to_string(SERVER_PORT));
+    LOG_INFO("Server starting with " + std::to_string(server_threads) + " worker threads.");
+    LOG_INFO("Listening on 0.0.0.0:" + std::to_string(SERVER_PORT));
 
     if (!svr.listen("0.0.0.0", SERVER_PORT)) {
-        log_message("ERROR: Server failed to start or encountered an error.");
+        LOG_ERROR("ERROR: Server failed to start or encountered an error.");
         exit(1);
     }
 }
 
-std::string ServerApp::extract_value_from_json(const std::string& json_body) {
-    std::string value_from_body;
-    size_t value_start = json_body.find("\"value\":\"");
-    if (value_start != std::string::npos) {
-        value_start += 9;
-        size_t value_end = json_body.find("\"", value_start);
-        if (value_end != std::string::npos) {
-            value_from_body = json_body.substr(value_start, value_end - value_start);
+void ServerApp::start_resp_listener() {
+    if (RESP_PORT <= 0) return;
+
+    LOG_INFO("RESP listener (GET/SET/DEL) starting on " + std::string(RESP_HOST) + ":" + std::to_string(RESP_PORT) + " with " + std::to_string(EVENT_LOOP_THREADS) + " event loops.");
+    httplib::TaskQueue* workers = executor.get();
+    std::thread([workers] {
+        EventServer resp_server(EVENT_LOOP_THREADS, *workers, false, EventServer::Protocol::RESP);
+        if (!resp_server.listen(RESP_HOST, RESP_PORT)) {
+            LOG_ERROR("ERROR: RESP listener failed to start, serving HTTP only.");
         }
+    }).detach();
+}
+
+void ServerApp::send_response(httplib::Response& res, KvResponse&& kv) {
+    res.status = kv.status;
+    for (auto& header : kv.headers) {
+        res.set_header(header.first, header.second);
+    }
+
+    if (kv.shared_body) {
+        // stream straight from the shared buffer instead of copying it into res.body
+        SharedBuffer body = std::move(kv.shared_body);
+        size_t length = body->size();
+        res.set_content_provider(length, kv.content_type,
+            [body = std::move(body)](size_t offset, size_t len, httplib::DataSink& sink) {
+                return sink.write(body->data() + offset, len);
+            });
+    } else if (!kv.content_type.empty()) {
+        res.set_content(std::move(kv.body), kv.content_type);
     }
-    return value_from_body;
+}
+
+bool ServerApp::route(const httplib::Request& req, httplib::Response& res) {
+    // httplib answers HEAD with the GET handler minus the body
+    std::string_view method = req.method == "HEAD" ? std::string_view("GET") : std::string_view(req.method);
+    RouteMatch match = match_route(method, req.path);
+    if (match.route == Route::NOT_FOUND) return false;
+    send_response(res, kv_handle(match, req.body, client_of(req),
+                                  kv_negotiate(req.get_header_value("Content-Type"), req.get_header_value("Accept"))));
+    return true;
+}
+
+std::string ServerApp::client_of(const httplib::Request& req) {
+    return req.remote_addr + ":" + std::to_string(req.remote_port);
 }
\ No newline at end of file
@@ -2,20 +2,40 @@
 #define SERVER_APP_H
 
 #include "httplib.h"
+#include "kv_service.h"
+#include <memory>
 #include <string>
 #include <iostream>
 
+// network front end serving the routes in kv_service.h
+enum class Frontend {
+    HTTPLIB, // httplib::Server, one worker thread per active connection
+    EPOLL,     // EventServer, event loops + DB worker pool
+    URING,     // UringServer, io_uring rings + DB worker pool
+    REUSEPORT  // EventServer per-core mode, one pinned SO_REUSEPORT listener + loop per thread + DB worker pool
+};
+
 class ServerApp {
 public:
     ServerApp();
-    void init(int num_threads);
+    void init(int num_threads, Frontend frontend = Frontend::HTTPLIB);
     void run();
 
 private:
     httplib::Server svr;
 
     int server_threads;
-    std::string extract_value_from_json(const std::string& json_body);
+    Frontend frontend;
+    // DB executor shared by the event-driven front ends and the RESP listener
+    // (httplib runs requests on its own pool, so there it only serves RESP)
+    std::unique_ptr<httplib::TaskQueue> executor;
+    // RESP_PORT listener in a background thread, next to whichever HTTP front end runs
+    void start_resp_listener();
+    // runs the kv_service handler for req if the router knows the route
+    bool route(const httplib::Request& req, httplib::Response& res);
+    // copies a KvResponse into httplib's response, shared bodies are streamed without copying
+    void send_response(httplib::Response& res, KvResponse&& kv);
+    static std::string client_of(const httplib::Request& req);
 };
 
 #endif
\ No newline at end of file
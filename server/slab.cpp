@@ -0,0 +1,141 @@
+#include "slab.h"
+#include "config.h"
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <atomic>
+
+namespace {
+
+// chunks are 16-byte aligned so any cache object can live in them
+const size_t SLAB_ALIGN = 16;
+
+struct FreeChunk {
+    FreeChunk* next;
+};
+
+struct SlabClass {
+    size_t chunk_size = 0;
+    FreeChunk* free_list = nullptr;
+    std::vector<char*> pages;
+    SlabClassStats stats{};
+    std::mutex class_mutex;
+};
+
+class SlabAllocatorImpl {
+public:
+    SlabAllocatorImpl() {
+        // chunk sizes grow geometrically from SLAB_MIN_CHUNK up to a full page
+        std::vector<size_t> sizes;
+        double size = SLAB_MIN_CHUNK;
+        while (size < SLAB_PAGE_SIZE / 2) {
+            size_t aligned = (static_cast<size_t>(size) + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1);
+            if (sizes.empty() || aligned > sizes.back()) sizes.push_back(aligned);
+            size *= SLAB_GROWTH_FACTOR;
+        }
+        sizes.push_back(SLAB_PAGE_SIZE);
+
+        classes = std::vector<SlabClass>(sizes.size());
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            classes[i].chunk_size = sizes[i];
+            classes[i].stats.chunk_size = sizes[i];
+        }
+        chunk_sizes = sizes;
+    }
+
+    void* alloc(size_t size) {
+        SlabClass* cls = class_for(size);
+        if (!cls) {
+            large_allocs.fetch_add(1, std::memory_order_relaxed);
+            return ::operator new(size);
+        }
+
+        std::lock_guard<std::mutex> lock(cls->class_mutex);
+        if (!cls->free_list) grow(*cls);
+        FreeChunk* chunk = cls->free_list;
+        cls->free_list = chunk->next;
+        cls->stats.used_chunks++;
+        cls->stats.allocs++;
+        return chunk;
+    }
+
+    void free(void* ptr, size_t size) {
+        if (!ptr) return;
+        SlabClass* cls = class_for(size);
+        if (!cls) {
+            ::operator delete(ptr);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(cls->class_mutex);
+        FreeChunk* chunk = static_cast<FreeChunk*>(ptr);
+        chunk->next = cls->free_list;
+        cls->free_list = chunk;
+        cls->stats.used_chunks--;
+        cls->stats.frees++;
+    }
+
+    std::vector<SlabClassStats> stats() {
+        std::vector<SlabClassStats> out;
+        for (auto& cls : classes) {
+            std::lock_guard<std::mutex> lock(cls.class_mutex);
+            if (cls.stats.pages > 0) out.push_back(cls.stats);
+        }
+        return out;
+    }
+
+    uint64_t large() const {
+        return large_allocs.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<SlabClass> classes;
+    std::vector<size_t> chunk_sizes;
+    std::atomic<uint64_t> large_allocs{0};
+
+    SlabClass* class_for(size_t size) {
+        auto it = std::lower_bound(chunk_sizes.begin(), chunk_sizes.end(), size);
+        if (it == chunk_sizes.end()) return nullptr;
+        return &classes[it - chunk_sizes.begin()];
+    }
+
+    // carve a new page into chunks, called with the class mutex held
+    void grow(SlabClass& cls) {
+        char* page = static_cast<char*>(::operator new(SLAB_PAGE_SIZE));
+        cls.pages.push_back(page);
+        size_t count = SLAB_PAGE_SIZE / cls.chunk_size;
+        for (size_t i = count; i > 0; --i) {
+            FreeChunk* chunk = reinterpret_cast<FreeChunk*>(page + (i - 1) * cls.chunk_size);
+            chunk->next = cls.free_list;
+            cls.free_list = chunk;
+        }
+        cls.stats.pages++;
+        cls.stats.total_chunks += count;
+    }
+};
+
+SlabAllocatorImpl& slabs() {
+    // constructed on first use and never destroyed, so static containers in
+    // other files can allocate and free in any initialization/exit order
+    static SlabAllocatorImpl* instance = new SlabAllocatorImpl();
+    return *instance;
+}
+
+}
+
+void* slab_alloc(size_t size) {
+    return slabs().alloc(size);
+}
+
+void slab_free(void* ptr, size_t size) {
+    slabs().free(ptr, size);
+}
+
+std::vector<SlabClassStats> slab_stats() {
+    return slabs().stats();
+}
+
+uint64_t slab_large_allocs() {
+    return slabs().large();
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef SERVER_SLAB_H
+#define SERVER_SLAB_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Size-classed slab allocator for cache memory (memcached style).
+// Memory is carved out of fixed-size pages into equal chunks per size class;
+// freed chunks go back to their class's free list and are reused, so the
+// cache stops hitting malloc once the working set is warmed up and its
+// footprint does not fragment over long runs. Pages are never returned.
+
+struct SlabClassStats {
+    size_t chunk_size;
+    size_t pages;
+    size_t total_chunks;
+    size_t used_chunks;
+    uint64_t allocs;
+    uint64_t frees;
+};
+
+void* slab_alloc(size_t size);
+void slab_free(void* ptr, size_t size); // size must match the slab_alloc call
+
+std::vector<SlabClassStats> slab_stats();
+// allocations larger than a page bypass the slabs
+uint64_t slab_large_allocs();
+
+// STL allocator on top of the slabs, used by the cache containers
+template <typename T>
+struct SlabAllocator {
+    using value_type = T;
+
+    SlabAllocator() noexcept = default;
+    template <typename U>
+    SlabAllocator(const SlabAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) { return static_cast<T*>(slab_alloc(n * sizeof(T))); }
+    void deallocate(T* ptr, size_t n) noexcept { slab_free(ptr, n * sizeof(T)); }
+};
+
+template <typename T, typename U>
+bool operator==(const SlabAllocator<T>&, const SlabAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const SlabAllocator<T>&, const SlabAllocator<U>&) { return false; }
+
+using SlabString = std::basic_string<char, std::char_traits<char>, SlabAllocator<char>>;
+
+#endif
\ No newline at end of file
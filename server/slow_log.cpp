@@ -0,0 +1,70 @@
+#include "slow_log.h"
+#include "config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace {
+
+std::mutex slow_mutex;
+std::vector<SlowRequest> current;   // min-heap on latency, this interval
+std::vector<SlowRequest> previous;  // the interval before, if it ended less than an interval ago
+uint64_t interval_ticks = 0;
+// read without the lock by slow_log_offer
+std::atomic<uint64_t> window_end{0};   // stage_now() at which current is retired
+std::atomic<uint64_t> admit_above{0};  // fastest latency kept while current is full
+
+bool slower(const SlowRequest& a, const SlowRequest& b) {
+    return a.latency_ns > b.latency_ns;
+}
+
+// called with slow_mutex held once now has passed window_end
+void rotate(uint64_t now) {
+    if (interval_ticks == 0) interval_ticks = stage_ticks(SLOW_LOG_INTERVAL_MS * 1000000ull);
+    uint64_t end = window_end.load(std::memory_order_relaxed);
+    bool adjacent = end != 0 && now < end + interval_ticks;
+    previous.clear();
+    if (adjacent) previous.swap(current);
+    current.clear();
+    window_end.store(adjacent ? end + interval_ticks : now + interval_ticks, std::memory_order_relaxed);
+    admit_above.store(0, std::memory_order_relaxed);
+}
+
+} // namespace
+
+void slow_log_offer(AccessOp op, std::string_view key, int status, uint64_t latency_ns, std::string_view client,
+                    const StageTrace& stages) {
+    if (SLOW_LOG_SIZE == 0) return;
+    uint64_t now = stage_now();
+    if (latency_ns <= admit_above.load(std::memory_order_relaxed) && now < window_end.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(slow_mutex);
+    if (now >= window_end.load(std::memory_order_relaxed)) rotate(now);
+    if (current.size() == SLOW_LOG_SIZE) {
+        if (latency_ns <= current.front().latency_ns) return;
+        std::pop_heap(current.begin(), current.end(), slower);
+        current.pop_back();
+    }
+    auto unix_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+    current.push_back({latency_ns, static_cast<uint64_t>(unix_ms.count()), op, status, std::string(key), std::string(client), stages});
+    std::push_heap(current.begin(), current.end(), slower);
+    if (current.size() == SLOW_LOG_SIZE) admit_above.store(current.front().latency_ns, std::memory_order_relaxed);
+}
+
+std::vector<SlowRequest> slow_log_snapshot() {
+    std::vector<SlowRequest> all;
+    {
+        std::lock_guard<std::mutex> lock(slow_mutex);
+        uint64_t now = stage_now();
+        if (now >= window_end.load(std::memory_order_relaxed)) rotate(now);
+        all = previous;
+        all.insert(all.end(), current.begin(), current.end());
+    }
+    std::sort(all.begin(), all.end(), slower);
+    if (all.size() > SLOW_LOG_SIZE) all.resize(SLOW_LOG_SIZE);
+    return all;
+}
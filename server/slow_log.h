@@ -0,0 +1,35 @@
+#ifndef SERVER_SLOW_LOG_H
+#define SERVER_SLOW_LOG_H
+
+#include "access_record.h"
+#include "metrics.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The SLOW_LOG_SIZE slowest requests of the current and the previous
+// SLOW_LOG_INTERVAL_MS interval, with the stage times of each (see
+// StageTrace in metrics.h), served by GET /admin/slow-requests. A request
+// only takes the lock when it is slower than the fastest one kept, so
+// once the interval has filled up the cost is a clock read and a compare.
+
+struct SlowRequest {
+    uint64_t latency_ns;
+    uint64_t unix_ms;       // when it finished
+    AccessOp op;
+    int status;
+    std::string key;
+    std::string client;     // "addr:port", identifies the connection
+    StageTrace stages;
+};
+
+// client is "addr:port" as passed to the kv handlers
+void slow_log_offer(AccessOp op, std::string_view key, int status, uint64_t latency_ns, std::string_view client,
+                    const StageTrace& stages);
+
+// slowest first, at most SLOW_LOG_SIZE
+std::vector<SlowRequest> slow_log_snapshot();
+
+#endif
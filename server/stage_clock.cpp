@@ -0,0 +1,38 @@
+#include "stage_clock.h"
+#include "logger.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+bool stage_clock_tsc = false;
+double stage_ns_per_tick = 1.0;
+
+static uint64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+void stage_clock_init() {
+#if defined(__x86_64__) || defined(__i386__)
+    // CPUID 0x80000007, EDX bit 8: the TSC ticks at a constant rate in every P/C-state
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8))) {
+        LOG_INFO("Stage timing uses CLOCK_MONOTONIC (no invariant TSC).");
+        return;
+    }
+    uint64_t ns_start = monotonic_ns();
+    uint64_t tsc_start = __rdtsc();
+    while (monotonic_ns() - ns_start < 10000000) {
+    }
+    uint64_t ns_elapsed = monotonic_ns() - ns_start;
+    uint64_t tsc_elapsed = __rdtsc() - tsc_start;
+    if (tsc_elapsed == 0) return;
+    stage_ns_per_tick = static_cast<double>(ns_elapsed) / static_cast<double>(tsc_elapsed);
+    stage_clock_tsc = true;
+    LOG_INFO("Stage timing uses the TSC (" + std::to_string(static_cast<int>(1000.0 / stage_ns_per_tick)) + " MHz).");
+#else
+    LOG_INFO("Stage timing uses CLOCK_MONOTONIC.");
+#endif
+}
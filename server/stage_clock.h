@@ -0,0 +1,42 @@
+#ifndef SERVER_STAGE_CLOCK_H
+#define SERVER_STAGE_CLOCK_H
+
+#include <cstdint>
+#include <ctime>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Cheap monotonic clock for timing the stages of a request. On x86 with an
+// invariant TSC a reading is one rdtsc (a few ns, no vDSO call); otherwise
+// it falls back to CLOCK_MONOTONIC. Readings are opaque ticks, only their
+// differences mean anything, and only after stage_clock_init() has run.
+
+extern bool stage_clock_tsc;
+extern double stage_ns_per_tick;
+
+// checks for an invariant TSC and calibrates it against CLOCK_MONOTONIC (~10 ms);
+// call once at the top of main, before any other thread exists: the values above are
+// plain globals, and the log writer reads the clock through log_mutex (see profiled_mutex.h)
+void stage_clock_init();
+
+inline uint64_t stage_now() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (stage_clock_tsc) return __rdtsc();
+#endif
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+inline uint64_t stage_elapsed_ns(uint64_t start) {
+    uint64_t ticks = stage_now() - start;
+    return stage_clock_tsc ? static_cast<uint64_t>(static_cast<double>(ticks) * stage_ns_per_tick) : ticks;
+}
+
+// a duration in ticks, for deadlines compared against stage_now()
+inline uint64_t stage_ticks(uint64_t ns) {
+    return stage_clock_tsc ? static_cast<uint64_t>(static_cast<double>(ns) / stage_ns_per_tick) : ns;
+}
+
+#endif
@@ -0,0 +1,642 @@
+#include "uring_server.h"
+#include "config.h"
+#include "http_codec.h"
+#include "kv_service.h"
+#include "logger.h"
+#include "metrics.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// user_data layout: connection id in the upper bits, operation in the low byte
+enum UringOp : uint64_t { OP_ACCEPT = 1, OP_RECV, OP_SEND, OP_WAKE, OP_TICK, OP_CANCEL };
+
+uint64_t pack(uint64_t conn_id, UringOp op) { return (conn_id << 8) | op; }
+
+const uint16_t RECV_BUFFER_GROUP = 0;
+
+// buffered input per connection, the largest request there is; at this point
+// reading stops and the rest waits in the socket
+const size_t INPUT_LIMIT = HTTP_MAX_HEADER_SIZE + HTTP_MAX_BODY_SIZE;
+
+int sys_io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+// Bare-bones io_uring: submission/completion rings plus one provided-buffer ring.
+// Only ever touched by the thread that owns it.
+class IoUring {
+public:
+    ~IoUring() {
+        if (buffers) munmap(buffers, buffer_bytes);
+        if (buf_ring) munmap(buf_ring, buf_ring_bytes);
+        if (sqes) munmap(sqes, sqes_bytes);
+        if (ring_ptr) munmap(ring_ptr, ring_bytes);
+        if (fd >= 0) close(fd);
+    }
+
+    bool init(unsigned entries) {
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4; // multishot requests produce many completions per submission
+        fd = sys_io_uring_setup(entries, &params);
+        if (fd < 0) return false;
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) return false;
+
+        size_t sq_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        size_t cq_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ring_bytes = std::max(sq_bytes, cq_bytes);
+        void* ring = mmap(nullptr, ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (ring == MAP_FAILED) return false;
+        ring_ptr = static_cast<char*>(ring);
+
+        sqes_bytes = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqe_mem = mmap(nullptr, sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqe_mem == MAP_FAILED) return false;
+        sqes = static_cast<io_uring_sqe*>(sqe_mem);
+
+        sq_head = reinterpret_cast<unsigned*>(ring_ptr + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(ring_ptr + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(ring_ptr + params.sq_off.ring_mask);
+        sq_entries = params.sq_entries;
+        cq_head = reinterpret_cast<unsigned*>(ring_ptr + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(ring_ptr + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(ring_ptr + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(ring_ptr + params.cq_off.cqes);
+
+        // sqe slots are used in order, so the indirection array is the identity
+        unsigned* sq_array = reinterpret_cast<unsigned*>(ring_ptr + params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries; ++i) sq_array[i] = i;
+        local_tail = *sq_tail;
+        return true;
+    }
+
+    // registers count buffers of size bytes each that recv picks from (IOSQE_BUFFER_SELECT)
+    bool init_buffers(unsigned count, unsigned size) {
+        buf_count = count;
+        buf_size = size;
+        buf_ring_bytes = count * sizeof(io_uring_buf);
+        void* mem = mmap(nullptr, buf_ring_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) return false;
+        buf_ring = static_cast<io_uring_buf_ring*>(mem);
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring);
+        reg.ring_entries = count;
+        reg.bgid = RECV_BUFFER_GROUP;
+        if (sys_io_uring_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) return false;
+
+        buffer_bytes = static_cast<size_t>(count) * size;
+        mem = mmap(nullptr, buffer_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) return false;
+        buffers = static_cast<char*>(mem);
+
+        for (unsigned i = 0; i < count; ++i) recycle_buffer(static_cast<uint16_t>(i));
+        return true;
+    }
+
+    const char* buffer(uint16_t bid) const { return buffers + static_cast<size_t>(bid) * buf_size; }
+
+    // hands a consumed buffer back to the kernel
+    void recycle_buffer(uint16_t bid) {
+        // entries start at offset 0 with the tail overlaid on bufs[0].resv; not indexed through
+        // io_uring_buf_ring::bufs because its flex-array wrapper is not zero-sized in C++
+        io_uring_buf* bufs = reinterpret_cast<io_uring_buf*>(buf_ring);
+        io_uring_buf* buf = &bufs[buf_tail & (buf_count - 1)];
+        buf->addr = reinterpret_cast<uint64_t>(buffer(bid));
+        buf->len = buf_size;
+        buf->bid = bid;
+        buf_tail++;
+        __atomic_store_n(&buf_ring->tail, buf_tail, __ATOMIC_RELEASE);
+    }
+
+    io_uring_sqe* get_sqe() {
+        if (local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+            submit(0); // full, push what we have to the kernel first
+            if (local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) return nullptr;
+        }
+        io_uring_sqe* sqe = &sqes[local_tail & sq_mask];
+        std::memset(sqe, 0, sizeof(*sqe));
+        local_tail++;
+        return sqe;
+    }
+
+    int submit(unsigned wait_for) {
+        unsigned to_submit = local_tail - *sq_tail;
+        __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+        unsigned flags = wait_for ? IORING_ENTER_GETEVENTS : 0;
+        if (to_submit == 0 && wait_for == 0) return 0;
+        return sys_io_uring_enter(fd, to_submit, wait_for, flags);
+    }
+
+    template <typename F>
+    void for_each_cqe(F&& handle) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            io_uring_cqe cqe = cqes[head & cq_mask];
+            head++;
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            handle(cqe);
+        }
+    }
+
+private:
+    int fd = -1;
+    char* ring_ptr = nullptr;
+    size_t ring_bytes = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqes_bytes = 0;
+
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned sq_entries = 0;
+    unsigned local_tail = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    io_uring_buf_ring* buf_ring = nullptr;
+    size_t buf_ring_bytes = 0;
+    char* buffers = nullptr;
+    size_t buffer_bytes = 0;
+    unsigned buf_count = 0;
+    unsigned buf_size = 0;
+    uint16_t buf_tail = 0;
+};
+
+std::string peer_string(int fd) {
+    sockaddr_storage addr{};
+    socklen_t len = sizeof(addr);
+    char host[INET6_ADDRSTRLEN] = {0};
+    int port = 0;
+    if (getpeername(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+        if (addr.ss_family == AF_INET) {
+            auto* in4 = reinterpret_cast<const sockaddr_in*>(&addr);
+            inet_ntop(AF_INET, &in4->sin_addr, host, sizeof(host));
+            port = ntohs(in4->sin_port);
+        } else if (addr.ss_family == AF_INET6) {
+            auto* in6 = reinterpret_cast<const sockaddr_in6*>(&addr);
+            inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+            port = ntohs(in6->sin6_port);
+        }
+    }
+    return std::string(host) + ":" + std::to_string(port);
+}
+
+}
+
+struct UringServer::Ring {
+    IoUring uring;
+    int wake_fd = -1; // eventfd, signalled when workers post completions
+    uint64_t wake_count = 0;
+    __kernel_timespec tick{};
+    std::thread thread;
+    // re-arms that found the submission queue full, retried at the top of the next loop pass
+    bool accept_pending = false;
+    bool wake_pending = false;
+    bool tick_pending = false;
+
+    uint64_t next_id = 1;
+    std::unordered_map<uint64_t, ConnectionPtr> connections;
+
+    std::mutex done_mutex;
+    std::vector<Completion> done;
+};
+
+UringServer::UringServer(int num_rings, httplib::TaskQueue& workers)
+    : num_rings(num_rings), workers(workers) {
+}
+
+UringServer::~UringServer() {
+    for (auto& ring : rings) {
+        if (ring->wake_fd >= 0) close(ring->wake_fd);
+    }
+    if (listen_fd >= 0) close(listen_fd);
+}
+
+bool UringServer::supported() {
+    // provided buffer rings (5.19) register fine on kernels that still reject multishot
+    // recv (6.0) with -EINVAL, so run one for real on a socketpair
+    IoUring probe;
+    if (!probe.init(8) || !probe.init_buffers(2, 64)) return false;
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) return false;
+    bool ok = false;
+    if (send(fds[1], "x", 1, MSG_NOSIGNAL) == 1) {
+        io_uring_sqe* sqe = probe.get_sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fds[0];
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = RECV_BUFFER_GROUP;
+        sqe->user_data = pack(0, OP_RECV);
+        // the byte is already queued, so the first completion arrives at once
+        if (probe.submit(1) >= 0) {
+            probe.for_each_cqe([&](const io_uring_cqe& cqe) {
+                if (cqe.user_data == pack(0, OP_RECV)) ok = ok || cqe.res == 1;
+            });
+        }
+    }
+    close(fds[0]);
+    close(fds[1]);
+    return ok;
+}
+
+bool UringServer::listen(const std::string& host, int port) {
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        LOG_ERROR("ERROR: socket() failed: " + std::string(strerror(errno)));
+        return false;
+    }
+    int yes = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd, SOMAXCONN) < 0) {
+        LOG_ERROR("ERROR: bind/listen failed: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    for (int i = 0; i < num_rings; ++i) {
+        std::unique_ptr<Ring> ring(new Ring());
+        ring->wake_fd = eventfd(0, EFD_CLOEXEC);
+        if (ring->wake_fd < 0 || !ring->uring.init(URING_ENTRIES)
+            || !ring->uring.init_buffers(URING_RECV_BUFFERS, URING_RECV_BUFFER_SIZE)) {
+            LOG_ERROR("ERROR: io_uring setup failed: " + std::string(strerror(errno)));
+            return false;
+        }
+        rings.push_back(std::move(ring));
+    }
+
+    for (auto& ring : rings) {
+        Ring* r = ring.get();
+        r->thread = std::thread([this, r] { run_ring(*r); });
+    }
+    for (auto& ring : rings) {
+        ring->thread.join();
+    }
+    return true;
+}
+
+void UringServer::run_ring(Ring& ring) {
+    arm_accept(ring);
+    arm_wake(ring);
+    arm_tick(ring);
+
+    for (;;) {
+        if (ring.accept_pending) arm_accept(ring);
+        if (ring.wake_pending) arm_wake(ring);
+        if (ring.tick_pending) arm_tick(ring);
+        // while one is still pending, only submit: the completions that free the queue may
+        // be the very ones it would wait for
+        bool pending = ring.accept_pending || ring.wake_pending || ring.tick_pending;
+        if (ring.uring.submit(pending ? 0 : 1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            LOG_ERROR("ERROR: io_uring_enter failed: " + std::string(strerror(errno)));
+            return;
+        }
+
+        ring.uring.for_each_cqe([&](const io_uring_cqe& cqe) {
+            UringOp op = static_cast<UringOp>(cqe.user_data & 0xff);
+            uint64_t conn_id = cqe.user_data >> 8;
+            bool more = cqe.flags & IORING_CQE_F_MORE;
+
+            switch (op) {
+            case OP_ACCEPT:
+                if (cqe.res >= 0) {
+                    on_accept(ring, cqe.res);
+                } else if (cqe.res != -EINTR && cqe.res != -ECONNABORTED) {
+                    LOG_ERROR("ERROR: accept failed: " + std::string(strerror(-cqe.res)));
+                }
+                if (!more) arm_accept(ring);
+                break;
+            case OP_RECV: {
+                auto it = ring.connections.find(conn_id);
+                if (it == ring.connections.end()) {
+                    if (cqe.flags & IORING_CQE_F_BUFFER) ring.uring.recycle_buffer(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                    break;
+                }
+                ConnectionPtr conn = it->second;
+                if (!more) conn->recv_armed = false;
+                on_recv(ring, conn, cqe.res, cqe.flags);
+                break;
+            }
+            case OP_SEND: {
+                auto it = ring.connections.find(conn_id);
+                if (it != ring.connections.end()) {
+                    ConnectionPtr conn = it->second;
+                    on_send(ring, conn, cqe.res);
+                }
+                break;
+            }
+            case OP_WAKE:
+                drain_completions(ring);
+                arm_wake(ring);
+                break;
+            case OP_TICK:
+                close_idle(ring);
+                arm_tick(ring);
+                break;
+            case OP_CANCEL:
+                break; // the cancelled recv reports on its own
+            }
+        });
+    }
+}
+
+void UringServer::arm_accept(Ring& ring) {
+    io_uring_sqe* sqe = ring.uring.get_sqe();
+    ring.accept_pending = !sqe;
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = pack(0, OP_ACCEPT);
+}
+
+void UringServer::arm_recv(Ring& ring, const ConnectionPtr& conn) {
+    io_uring_sqe* sqe = ring.uring.get_sqe();
+    if (!sqe) {
+        close_connection(ring, conn);
+        return;
+    }
+    // multishot: one submission keeps producing a completion per chunk received
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RECV_BUFFER_GROUP;
+    sqe->user_data = pack(conn->id, OP_RECV);
+    conn->recv_armed = true;
+}
+
+// cancels the multishot recv of a connection whose input buffer is full; its last
+// completion (-ECANCELED) clears recv_armed, and resume_recv arms it again once
+// requests have been taken out of the buffer. Whatever arrives meanwhile stays in the socket.
+void UringServer::pause_recv(Ring& ring, const ConnectionPtr& conn) {
+    if (conn->recv_paused || !conn->recv_armed) return;
+    io_uring_sqe* sqe = ring.uring.get_sqe();
+    if (!sqe) return; // tried again with the next chunk received
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = pack(conn->id, OP_RECV);
+    sqe->user_data = pack(conn->id, OP_CANCEL);
+    conn->recv_paused = true;
+}
+
+void UringServer::resume_recv(Ring& ring, const ConnectionPtr& conn) {
+    if (!conn->recv_paused || conn->recv_armed || conn->closed || conn->in.size() >= INPUT_LIMIT) return;
+    conn->recv_paused = false;
+    arm_recv(ring, conn);
+}
+
+void UringServer::arm_wake(Ring& ring) {
+    io_uring_sqe* sqe = ring.uring.get_sqe();
+    ring.wake_pending = !sqe;
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = ring.wake_fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&ring.wake_count);
+    sqe->len = sizeof(ring.wake_count);
+    sqe->user_data = pack(0, OP_WAKE);
+}
+
+void UringServer::arm_tick(Ring& ring) {
+    io_uring_sqe* sqe = ring.uring.get_sqe();
+    ring.tick_pending = !sqe;
+    if (!sqe) return;
+    ring.tick.tv_sec = 1;
+    ring.tick.tv_nsec = 0;
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(&ring.tick);
+    sqe->len = 1;
+    sqe->user_data = pack(0, OP_TICK);
+}
+
+void UringServer::on_accept(Ring& ring, int fd) {
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+    ConnectionPtr conn = std::make_shared<Connection>();
+    conn->id = ring.next_id++;
+    conn->fd = fd;
+    conn->ring = &ring;
+    conn->client = peer_string(fd);
+    conn->last_active = std::chrono::steady_clock::now();
+    ring.connections[conn->id] = conn;
+    arm_recv(ring, conn);
+}
+
+void UringServer::on_recv(Ring& ring, const ConnectionPtr& conn, int res, uint32_t flags) {
+    if (res > 0 && (flags & IORING_CQE_F_BUFFER)) {
+        uint16_t bid = flags >> IORING_CQE_BUFFER_SHIFT;
+        conn->in.append(ring.uring.buffer(bid), res);
+        ring.uring.recycle_buffer(bid);
+    }
+
+    if (conn->closed) {
+        release_if_done(ring, conn);
+        return;
+    }
+    if (res == -ECANCELED && conn->recv_paused) {
+        process(ring, conn);
+        resume_recv(ring, conn);
+        return;
+    }
+    if (res < 0 && res != -ENOBUFS) {
+        close_connection(ring, conn); // the socket failed
+        return;
+    }
+    // half close (shutdown(SHUT_WR), HTTP/1.0 style clients): the requests
+    // already read are still answered, process() closes once they are sent
+    if (res == 0) conn->peer_closed = true;
+
+    conn->last_active = std::chrono::steady_clock::now();
+    if (conn->in.size() >= INPUT_LIMIT) pause_recv(ring, conn);
+    if (!conn->recv_armed && !conn->recv_paused && !conn->peer_closed) {
+        // out of buffers or the kernel ended the multishot; with the buffer full there
+        // is nothing to cancel, resume_recv arms it once requests are taken out
+        if (conn->in.size() < INPUT_LIMIT) {
+            arm_recv(ring, conn);
+        } else {
+            conn->recv_paused = true;
+        }
+    }
+    process(ring, conn);
+    resume_recv(ring, conn);
+}
+
+void UringServer::process(Ring& ring, const ConnectionPtr& conn) {
+    while (!conn->busy && !conn->close_after_write && !conn->closed) {
+        HttpRequest req;
+        size_t consumed = 0;
+        uint64_t parse_start = stage_now();
+        ParseStatus status = parse_http_request(conn->in, req, consumed);
+        if (status == ParseStatus::INCOMPLETE) {
+            if (conn->in.size() >= INPUT_LIMIT) {
+                close_connection(ring, conn); // larger than any valid request
+            } else if (conn->peer_closed) {
+                // nothing more is coming: close once the answers are sent
+                conn->close_after_write = true;
+                start_send(ring, conn);
+            }
+            return;
+        }
+        if (status == ParseStatus::BAD) {
+            KvResponse res;
+            res.status = 400;
+            res.content_type.clear();
+            conn->out += format_http_response(res, false);
+            conn->close_after_write = true;
+            start_send(ring, conn);
+            return;
+        }
+        metrics_stage_since(MetricStage::PARSE, parse_start);
+        conn->in.erase(0, consumed);
+
+        KvResponse res;
+        KvFormats formats = kv_negotiate(req.content_type, req.accept);
+        if (kv_dispatch_cached(req.method, req.path, conn->client, res, formats.response)) {
+            // fast lane: cache hit, answer on the ring thread and look for the next buffered request
+            conn->out += format_http_response(res, req.keep_alive);
+            if (!req.keep_alive) conn->close_after_write = true;
+            start_send(ring, conn);
+            continue;
+        }
+
+        // misses and writes go to the DB executor
+        conn->busy = true;
+        metrics_trace_reset(); // the parse time traced here must not reach the ring's next request
+        workers.enqueue([conn, req = std::move(req), formats]() {
+            KvResponse res = kv_dispatch(req.method, req.path, req.body, conn->client, formats, true); // fast lane missed
+            Ring& owner = *conn->ring;
+            {
+                std::lock_guard<std::mutex> lock(owner.done_mutex);
+                owner.done.push_back({conn, format_http_response(res, req.keep_alive), req.keep_alive});
+            }
+            uint64_t one = 1;
+            ssize_t ignored = write(owner.wake_fd, &one, sizeof(one));
+            (void)ignored;
+        });
+    }
+}
+
+void UringServer::drain_completions(Ring& ring) {
+    std::vector<Completion> done;
+    {
+        std::lock_guard<std::mutex> lock(ring.done_mutex);
+        done.swap(ring.done);
+    }
+
+    for (Completion& c : done) {
+        ConnectionPtr& conn = c.conn;
+        conn->busy = false;
+        if (conn->closed) {
+            release_if_done(ring, conn);
+            continue;
+        }
+
+        conn->out += c.response;
+        if (!c.keep_alive) conn->close_after_write = true;
+        conn->last_active = std::chrono::steady_clock::now();
+        start_send(ring, conn);
+        process(ring, conn); // a pipelined request may already be buffered
+        resume_recv(ring, conn);
+    }
+}
+
+void UringServer::start_send(Ring& ring, const ConnectionPtr& conn) {
+    if (conn->send_in_flight || conn->closed) return;
+    if (conn->sending_offset >= conn->sending.size()) {
+        if (conn->out.empty()) {
+            if (conn->close_after_write) close_connection(ring, conn);
+            return;
+        }
+        conn->sending.swap(conn->out);
+        conn->out.clear();
+        conn->sending_offset = 0;
+    }
+
+    io_uring_sqe* sqe = ring.uring.get_sqe();
+    if (!sqe) {
+        close_connection(ring, conn);
+        return;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(conn->sending.data() + conn->sending_offset);
+    sqe->len = static_cast<uint32_t>(conn->sending.size() - conn->sending_offset);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = pack(conn->id, OP_SEND);
+    conn->send_in_flight = true;
+    conn->send_started = stage_now();
+}
+
+void UringServer::on_send(Ring& ring, const ConnectionPtr& conn, int res) {
+    conn->send_in_flight = false;
+    if (res > 0) metrics_stage_since(MetricStage::WRITE, conn->send_started); // submission to completion
+    if (conn->closed) {
+        release_if_done(ring, conn);
+        return;
+    }
+    if (res < 0) {
+        close_connection(ring, conn);
+        return;
+    }
+    conn->sending_offset += res;
+    start_send(ring, conn); // rest of a short send, or whatever queued up meanwhile
+}
+
+void UringServer::close_connection(Ring& ring, const ConnectionPtr& conn) {
+    if (conn->closed) return;
+    conn->closed = true;
+    // wakes the armed recv (and fails a pending send) so the kernel drops its references
+    shutdown(conn->fd, SHUT_RDWR);
+    release_if_done(ring, conn);
+}
+
+void UringServer::release_if_done(Ring& ring, const ConnectionPtr& conn) {
+    // the fd may only be reused once no submitted operation refers to it
+    if (conn->recv_armed || conn->send_in_flight || conn->fd < 0) return;
+    close(conn->fd);
+    conn->fd = -1;
+    ring.connections.erase(conn->id);
+}
+
+void UringServer::close_idle(Ring& ring) {
+    auto deadline = std::chrono::steady_clock::now() - std::chrono::seconds(EVENT_IDLE_TIMEOUT_S);
+    std::vector<ConnectionPtr> idle;
+    for (auto& entry : ring.connections) {
+        const ConnectionPtr& conn = entry.second;
+        if (!conn->closed && !conn->busy && conn->last_active < deadline) idle.push_back(conn);
+    }
+    for (auto& conn : idle) {
+        close_connection(ring, conn);
+    }
+}
\ No newline at end of file
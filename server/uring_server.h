@@ -0,0 +1,88 @@
+#ifndef SERVER_URING_SERVER_H
+#define SERVER_URING_SERVER_H
+
+#include "httplib.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// io_uring HTTP front end (Linux 6.0+), same routes as the other front ends.
+// Each ring thread keeps a multishot accept armed on the shared listening
+// socket and one multishot recv per connection that reads into a ring of
+// kernel-registered buffers (IORING_REGISTER_PBUF_RING), so steady-state
+// traffic needs one io_uring_enter per batch of events instead of a
+// syscall per accept/recv/send. As in EventServer, cache hits are answered
+// on the ring thread and only database work goes to the worker pool. Talks to the kernel directly, liburing is not needed.
+
+class UringServer {
+public:
+    // workers is the DB executor; it is not owned and may be shared with another server
+    UringServer(int num_rings, httplib::TaskQueue& workers);
+    ~UringServer();
+
+    // false if this kernel cannot run the front end (io_uring missing or too old)
+    static bool supported();
+
+    // blocks serving requests; returns false if the socket or rings could not be set up
+    bool listen(const std::string& host, int port);
+
+private:
+    struct Ring;
+
+    struct Connection {
+        uint64_t id;
+        int fd;
+        Ring* ring;
+        std::string client; // "addr:port" for the access log
+        std::string in;
+        std::string out;      // responses waiting for the current send to finish
+        std::string sending;  // buffer owned by the in-flight send
+        size_t sending_offset = 0;
+        bool busy = false;    // a request is with the DB executor
+        bool recv_armed = false;
+        bool recv_paused = false;  // input buffer full, the multishot recv was cancelled
+        bool send_in_flight = false;
+        uint64_t send_started = 0; // stage_now() when the in-flight send was submitted
+        bool close_after_write = false;
+        bool peer_closed = false; // peer shut down its side: answer what it sent, then close
+        bool closed = false;
+        std::chrono::steady_clock::time_point last_active;
+    };
+    using ConnectionPtr = std::shared_ptr<Connection>;
+
+    struct Completion {
+        ConnectionPtr conn;
+        std::string response;
+        bool keep_alive;
+    };
+
+    int num_rings;
+    int listen_fd = -1;
+    std::vector<std::unique_ptr<Ring>> rings;
+    httplib::TaskQueue& workers; // DB executor
+
+    void run_ring(Ring& ring);
+    void arm_accept(Ring& ring);
+    void arm_recv(Ring& ring, const ConnectionPtr& conn);
+    void pause_recv(Ring& ring, const ConnectionPtr& conn);
+    void resume_recv(Ring& ring, const ConnectionPtr& conn);
+    void arm_wake(Ring& ring);
+    void arm_tick(Ring& ring);
+    void on_accept(Ring& ring, int fd);
+    void on_recv(Ring& ring, const ConnectionPtr& conn, int res, uint32_t flags);
+    void on_send(Ring& ring, const ConnectionPtr& conn, int res);
+    void process(Ring& ring, const ConnectionPtr& conn);
+    void start_send(Ring& ring, const ConnectionPtr& conn);
+    void drain_completions(Ring& ring);
+    void close_connection(Ring& ring, const ConnectionPtr& conn);
+    void release_if_done(Ring& ring, const ConnectionPtr& conn);
+    void close_idle(Ring& ring);
+};
+
+#endif
\ No newline at end of file
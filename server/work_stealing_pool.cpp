@@ -0,0 +1,187 @@
+#include "work_stealing_pool.h"
+#include "config.h"
+#include "metrics.h"
+#include "stage_clock.h"
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// --- TaskRing ---
+
+WorkStealingPool::TaskRing::TaskRing(size_t capacity)
+    : cells(new Cell[capacity]), mask(capacity - 1), enqueue_pos(0), dequeue_pos(0) {
+    for (size_t i = 0; i < capacity; ++i) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool WorkStealingPool::TaskRing::push(Task& task) {
+    Cell* cell;
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return false; // full
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->task = std::move(task);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool WorkStealingPool::TaskRing::pop(Task& task) {
+    Cell* cell;
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return false; // empty
+        } else {
+            pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    task = std::move(cell->task);
+    cell->task.fn = nullptr;
+    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    return true;
+}
+
+size_t WorkStealingPool::TaskRing::size() const {
+    size_t head = dequeue_pos.load(std::memory_order_relaxed);
+    size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+}
+
+// --- WorkStealingPool ---
+
+WorkStealingPool::WorkStealingPool(size_t num_workers) {
+    for (size_t i = 0; i < num_workers; ++i) {
+        workers.emplace_back(new Worker(WS_QUEUE_CAPACITY));
+    }
+    for (size_t i = 0; i < num_workers; ++i) {
+        workers[i]->thread = std::thread([this, i] { run(i); });
+    }
+    queue_gauge = metrics_register("kv_executor_queue_depth", "Tasks waiting for a worker thread, all pools.",
+                                   [this] { return static_cast<double>(queued()); });
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    metrics_unregister(queue_gauge);
+    if (!stopping.load()) shutdown();
+}
+
+size_t WorkStealingPool::queued() const {
+    size_t total = overflow_size.load(std::memory_order_relaxed);
+    for (const auto& worker : workers) total += worker->tasks.size();
+    return total;
+}
+
+bool WorkStealingPool::enqueue(std::function<void()> fn) {
+    Task task{std::move(fn), stage_now()};
+    size_t n = workers.size();
+    size_t start = next_worker.fetch_add(1, std::memory_order_relaxed);
+    bool queued = false;
+    for (size_t i = 0; i < n && !queued; ++i) {
+        queued = workers[(start + i) % n]->tasks.push(task);
+    }
+    if (!queued) {
+        std::lock_guard<std::mutex> lock(overflow_mutex);
+        overflow.push_back(std::move(task));
+        overflow_size.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // pairs with the sleepers increment in run(): either we see the sleeper, or it sees the task
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) > 0) wake_one();
+    return true;
+}
+
+void WorkStealingPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(park_mutex);
+        stopping.store(true);
+        wake_epoch++;
+    }
+    park_cond.notify_all();
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+}
+
+void WorkStealingPool::wake_one() {
+    {
+        std::lock_guard<std::mutex> lock(park_mutex);
+        wake_epoch++;
+    }
+    park_cond.notify_one();
+}
+
+// own queue first, then steal from the others in order, then the overflow list
+bool WorkStealingPool::take(size_t self, Task& task) {
+    size_t n = workers.size();
+    for (size_t i = 0; i < n; ++i) {
+        if (workers[(self + i) % n]->tasks.pop(task)) return true;
+    }
+    if (overflow_size.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(overflow_mutex);
+        if (!overflow.empty()) {
+            task = std::move(overflow.front());
+            overflow.pop_front();
+            overflow_size.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(size_t self) {
+    Task task;
+    for (;;) {
+        bool found = take(self, task);
+        for (int spin = 0; !found && spin < WS_SPIN_ITERATIONS; ++spin) {
+            cpu_relax();
+            found = take(self, task);
+        }
+
+        if (!found) {
+            uint64_t epoch;
+            {
+                std::lock_guard<std::mutex> lock(park_mutex);
+                epoch = wake_epoch;
+            }
+            sleepers.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            found = take(self, task); // a task may have arrived before we were counted
+            if (!found) {
+                if (stopping.load()) {
+                    sleepers.fetch_sub(1);
+                    break; // queues drained
+                }
+                std::unique_lock<std::mutex> lock(park_mutex);
+                park_cond.wait(lock, [&] { return wake_epoch != epoch; });
+            }
+            sleepers.fetch_sub(1);
+            if (!found) continue;
+        }
+
+        metrics_trace_reset(); // a task starts a new slow log trace
+        metrics_stage_since(MetricStage::QUEUE, task.enqueued);
+        task.fn();
+        task.fn = nullptr;
+    }
+}
\ No newline at end of file
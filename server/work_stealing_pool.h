@@ -0,0 +1,89 @@
+#ifndef SERVER_WORK_STEALING_POOL_H
+#define SERVER_WORK_STEALING_POOL_H
+
+#include "httplib.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Drop-in replacement for httplib::ThreadPool.
+// Every worker owns a bounded lock-free queue; enqueue spreads tasks over
+// the workers round-robin, an idle worker steals from the others, spins
+// for a short while and only then parks on the condition variable. The
+// common path takes no lock and wakes nobody when all workers are busy.
+// Tasks that find every queue full go to a mutex-protected overflow list.
+
+class WorkStealingPool final : public httplib::TaskQueue {
+public:
+    explicit WorkStealingPool(size_t num_workers);
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    ~WorkStealingPool() override;
+
+    bool enqueue(std::function<void()> fn) override;
+    void shutdown() override;
+
+    // tasks waiting for a worker, approximate while producers and consumers run
+    size_t queued() const;
+
+private:
+    struct Task {
+        std::function<void()> fn;
+        uint64_t enqueued = 0; // stage_now() at enqueue, for the queue wait metric
+    };
+
+    // bounded multi-producer multi-consumer ring (D. Vyukov); producers are the
+    // accepting threads, consumers are the owner and any thief
+    class TaskRing {
+    public:
+        explicit TaskRing(size_t capacity);
+        bool push(Task& task);
+        bool pop(Task& task);
+        size_t size() const;
+
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            Task task;
+        };
+        std::unique_ptr<Cell[]> cells;
+        size_t mask;
+        alignas(64) std::atomic<size_t> enqueue_pos;
+        alignas(64) std::atomic<size_t> dequeue_pos;
+    };
+
+    struct alignas(64) Worker {
+        explicit Worker(size_t capacity) : tasks(capacity) {}
+        TaskRing tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<size_t> next_worker{0};
+
+    std::mutex overflow_mutex;
+    std::deque<Task> overflow;
+    std::atomic<size_t> overflow_size{0};
+
+    // parking
+    std::atomic<int> sleepers{0};
+    std::mutex park_mutex;
+    std::condition_variable park_cond;
+    uint64_t wake_epoch = 0;
+    std::atomic<bool> stopping{false};
+
+    int queue_gauge; // metrics registration
+
+    void run(size_t self);
+    bool take(size_t self, Task& task);
+    void wake_one();
+};
+
+#endif
\ No newline at end of file